@@ -4,11 +4,41 @@
 
 #include "shared.h"
 #include "syscalls.h"
-
-SEC("lsm/bprm_check_security")
-int BPF_PROG(enforce_proc, struct linux_binprm *bprm, int ret) {
+#include <bpf/bpf_endian.h>
+
+#define AF_INET 2
+#define AF_INET6 10
+
+#define MAX_NET_PORT_RANGES 8
+
+// LPM key for address rules, data is the operation and the address family
+// followed by the address so that IPv4 and IPv6 prefixes never overlap
+struct net_addr_key {
+  u32 prefixlen;
+  u8 op;
+  u8 family;
+  u8 addr[16];
+  u8 pad[2];
+};
+
+// Port range table of an address prefix, userspace appends the ranges of the
+// enclosing prefixes behind the ones of the prefix itself
+struct net_port_range {
+  u16 lo;
+  u16 hi;
+  struct data_t rule;
+};
+
+struct net_addr_val {
+  u32 count;
+  struct net_port_range ports[MAX_NET_PORT_RANGES];
+};
+
+struct outer_hash kubearmor_net_rules SEC(".maps");
+
+static __always_inline int match_proc_rules(struct linux_binprm *bprm,
+                                            int ret) {
   struct task_struct *t = (struct task_struct *)bpf_get_current_task();
-  event *task_info;
   int retval = ret;
 
   bool match = false;
@@ -22,6 +52,12 @@ int BPF_PROG(enforce_proc, struct linux_binprm *bprm, int ret) {
     return 0;
   }
 
+  struct container_hdr *hdr =
+      bpf_map_lookup_elem(&kubearmor_container_hdr, &okey);
+  if (!has_rules(hdr, PROC_CLASS)) {
+    return 0;
+  }
+
   u32 zero = 0;
   bufs_k *z = bpf_map_lookup_elem(&bufk, &zero);
   if (z == NULL)
@@ -40,183 +76,100 @@ int BPF_PROG(enforce_proc, struct linux_binprm *bprm, int ret) {
     return 0;
 
   // Extract full path from file structure provided by LSM Hook
-  bufs_t *path_buf = get_buf(PATH_BUFFER);
-  if (path_buf == NULL)
-    return 0;
   struct path f_path = BPF_CORE_READ(bprm->file, f_path);
-  if (!prepend_path(&f_path, path_buf))
+  long path_len = resolve_path(&f_path, store->path);
+  if (path_len <= 0)
     return 0;
 
-  u32 *path_offset = get_buf_off(PATH_BUFFER);
-  if (path_offset == NULL)
-    return 0;
+  u64 path_hash = rule_hash(store->path);
+
+  struct qstr d_name;
+  d_name = BPF_CORE_READ(f_path.dentry, d_name);
+
+  // Length of the parent directory prefix including the trailing slash, used
+  // to match non recursive directory rules
+  u32 parent_len = path_len - 1 - d_name.len;
 
-  void *path_ptr = &path_buf->buf[*path_offset];
-  bpf_probe_read_str(store->path, MAX_STRING_SIZE, path_ptr);
+  u32 *dirs = bpf_map_lookup_elem(&kubearmor_dir_rules, &okey);
+  struct dir_key *dk = bpf_map_lookup_elem(&dirk, &zero);
+  if (dk == NULL)
+    return 0;
 
-  struct data_t *val = bpf_map_lookup_elem(inner, store);
-  struct data_t *dirval;
-  bool recursivebuthint = false;
+  struct data_t *val = NULL;
+  struct dir_val *dirval;
+  struct data_t dirrule = {};
   bool fromSourceCheck = true;
 
-  // Extract full path of the source binary from the parent task structure
+  // Extract full path of the source binary from the parent task structure,
+  // skipped when no process rule is qualified with fromSource
+  if (!has_from_source_rules(hdr, PROC_CLASS))
+    fromSourceCheck = false;
   struct task_struct *parent_task = BPF_CORE_READ(t, parent);
   struct file *file_p = get_task_file(parent_task);
   if (file_p == NULL)
     fromSourceCheck = false;
-  bufs_t *src_buf = get_buf(PATH_BUFFER);
-  if (src_buf == NULL)
-    fromSourceCheck = false;
   struct path f_src = BPF_CORE_READ(file_p, f_path);
-  if (!prepend_path(&f_src, src_buf))
-    fromSourceCheck = false;
-
-  u32 *src_offset = get_buf_off(PATH_BUFFER);
-  if (src_offset == NULL)
-    fromSourceCheck = false;
-
-  void *src_ptr = &src_buf->buf[*src_offset];
-  if (src_ptr == NULL)
+  if (fromSourceCheck && !resolve_path(&f_src, store->source))
     fromSourceCheck = false;
 
   if (fromSourceCheck) {
-    bpf_probe_read_str(store->source, MAX_STRING_SIZE, src_ptr);
+    u64 source_hash = hash_str(store->source);
 
-    val = bpf_map_lookup_elem(inner, store);
+    val = lookup_rule(inner, &okey, store, path_hash, source_hash);
     if (val && (val->processmask & RULE_EXEC)) {
       match = true;
       goto decision;
     }
 
-#pragma unroll
-    for (int i = 0; i < 64; i++) {
-      if (store->path[i] == '\0')
-        break;
-
-      if (store->path[i] == '/') {
-        bpf_map_update_elem(&bufk, &two, z, BPF_ANY);
-
-        match = false;
-
-        bpf_probe_read_str(pk->path, i + 2, store->path);
-        // Check Subdir with From Source
-        bpf_probe_read_str(pk->source, MAX_STRING_SIZE, store->source);
-        dirval = bpf_map_lookup_elem(inner, pk);
-        if (dirval) {
-          if ((dirval->processmask & RULE_DIR) &&
-              (dirval->processmask & RULE_EXEC)) {
-            match = true;
-            if ((dirval->processmask & RULE_RECURSIVE) &&
-                (~dirval->processmask &
-                 RULE_HINT)) { // true directory match and not a hint suggests
-                               // there are no possibility of child dir
-              val = dirval;
-              goto decision;
-            } else if (dirval->processmask &
-                       RULE_RECURSIVE) { // It's a directory match but also a
-                                         // hint, it's possible that a
-                                         // subdirectory exists that can also
-              // match so we continue the loop to look
-              // for a true match in subdirectories
-              recursivebuthint = true;
-              val = dirval;
-            } else {
-              continue; // We continue the loop to see if we have more nested
-                        // directories and set match to false
-            }
-          }
-        } else {
-          break;
+    // Check Subdir with From Source
+    if (dirs) {
+      dirval = lookup_dir_rule(dirs, dk, store->path, store->source,
+                               (u32)source_hash);
+      if (dirval) {
+        resolve_dir_rule(dirval, parent_len, &dirrule);
+        if ((dirrule.processmask & RULE_DIR) &&
+            (dirrule.processmask & RULE_EXEC)) {
+          match = true;
+          val = &dirrule;
+          goto decision;
         }
       }
     }
-
-    if (recursivebuthint) {
-      match = true;
-      goto decision;
-    }
-    if (match) {
-      if (dirval) { // to please the holy verifier
-        val = dirval;
-        goto decision;
-      }
-    }
   }
   bpf_map_update_elem(&bufk, &two, z, BPF_ANY);
   bpf_probe_read_str(pk->path, MAX_STRING_SIZE, store->path);
 
-  val = bpf_map_lookup_elem(inner, pk);
+  val = lookup_rule(inner, &okey, pk, path_hash, EMPTY_HASH);
 
   if (val && (val->processmask & RULE_EXEC)) {
     match = true;
     goto decision;
   }
 
-
   // match exec name
-  struct qstr d_name;
-  d_name = BPF_CORE_READ(f_path.dentry,d_name);
   bpf_map_update_elem(&bufk, &two, z, BPF_ANY);
   bpf_probe_read_str(pk->path, MAX_STRING_SIZE, d_name.name);
 
-  val = bpf_map_lookup_elem(inner, pk);
+  val = lookup_rule(inner, &okey, pk, rule_hash(pk->path), EMPTY_HASH);
 
   if (val && (val->processmask & RULE_EXEC)) {
     match = true;
     goto decision;
   }
 
-  recursivebuthint = false;
-
-#pragma unroll
-  for (int i = 0; i < 64; i++) {
-    if (store->path[i] == '\0')
-      break;
-
-    if (store->path[i] == '/') {
-      bpf_map_update_elem(&bufk, &two, z, BPF_ANY);
-
-      match = false;
-
-      bpf_probe_read_str(pk->path, i + 2, store->path);
-      dirval = bpf_map_lookup_elem(inner, pk);
-      if (dirval) {
-        if ((dirval->processmask & RULE_DIR) &&
-            (dirval->processmask & RULE_EXEC)) {
-          match = true;
-          if ((dirval->processmask & RULE_RECURSIVE) &&
-              (~dirval->processmask &
-               RULE_HINT)) { // true directory match and not a hint suggests
-                             // there are no possibility of child dir match
-            val = dirval;
-            goto decision;
-          } else if (dirval->processmask & RULE_RECURSIVE) {
-            recursivebuthint = true;
-            val = dirval;
-          } else {
-            continue; // We continue the loop to see if we have more nested
-                      // directories and set match to false
-          }
-        }
-        if (~dirval->processmask & RULE_HINT) {
-          break;
-        }
-      } else {
-        break;
+  if (dirs) {
+    dirval = lookup_dir_rule(dirs, dk, store->path, NULL, 0);
+    if (dirval) {
+      resolve_dir_rule(dirval, parent_len, &dirrule);
+      if ((dirrule.processmask & RULE_DIR) &&
+          (dirrule.processmask & RULE_EXEC)) {
+        match = true;
+        val = &dirrule;
+        goto decision;
       }
     }
   }
 
-  if (recursivebuthint) {
-    match = true;
-    goto decision;
-  } else {
-    if (match && dirval) {
-      val = dirval;
-      goto decision;
-    }
-  }
-
 decision:
 
   if (match) {
@@ -234,47 +187,37 @@ decision:
   }
 
   if (retval == -EPERM) {
-    goto ringbuf;
+    goto alert;
   }
 
-  bpf_map_update_elem(&bufk, &two, z, BPF_ANY);
-  pk->path[0] = dproc;
-  struct data_t *allow = bpf_map_lookup_elem(inner, pk);
+  u8 posture = class_posture(hdr, PROC_CLASS, inner, &okey, pk, z, two);
 
-  if (allow) {
+  if (posture) {
     if (!match) {
-      if (allow->processmask == BLOCK_POSTURE) {
+      if (posture == BLOCK_POSTURE) {
         retval = -EPERM;
       }
-      goto ringbuf;
+      goto alert;
     }
   }
 
   return ret;
 
-ringbuf:
-
-  task_info = bpf_ringbuf_reserve(&kubearmor_events, sizeof(event), 0);
-  if (!task_info) {
-    // Failed to reserve, doing policy enforcement without alert
-    return retval;
-  }
-
-  // Clearing arrays to avoid garbage values
-  __builtin_memset(task_info->data.path, 0, sizeof(task_info->data.path));
-  __builtin_memset(task_info->data.source, 0, sizeof(task_info->data.source));
+alert:
+  // Doing policy enforcement without alert if the ring buffer is full
+  submit_alert(_SECURITY_BPRM_CHECK, retval, store->path, store->source);
+  return retval;
+}
 
-  init_context(task_info);
-  bpf_probe_read_str(&task_info->data.path, MAX_STRING_SIZE, store->path);
-  bpf_probe_read_str(&task_info->data.source, MAX_STRING_SIZE, store->source);
-  task_info->event_id = _SECURITY_BPRM_CHECK;
-  task_info->retval = retval;
-  bpf_ringbuf_submit(task_info, 0);
+SEC("lsm/bprm_check_security")
+int BPF_PROG(enforce_proc, struct linux_binprm *bprm, int ret) {
+  STATS_START();
+  int retval = match_proc_rules(bprm, ret);
+  STATS_RECORD(_SECURITY_BPRM_CHECK, retval);
   return retval;
 }
 
 static inline int match_net_rules(int type, int protocol, u32 eventID) {
-  event *task_info;
   int retval = 0;
 
   struct task_struct *t = (struct task_struct *)bpf_get_current_task();
@@ -289,6 +232,13 @@ static inline int match_net_rules(int type, int protocol, u32 eventID) {
   if (!inner) {
     return 0;
   }
+
+  struct container_hdr *hdr =
+      bpf_map_lookup_elem(&kubearmor_container_hdr, &okey);
+  if (!has_rules(hdr, NET_CLASS)) {
+    return 0;
+  }
+
   u32 zero = 0;
   bufs_k *z = bpf_map_lookup_elem(&bufk, &zero);
   if (z == NULL)
@@ -307,24 +257,16 @@ static inline int match_net_rules(int type, int protocol, u32 eventID) {
   bpf_map_update_elem(&bufk, &one, z, BPF_ANY);
   int p0;
   int p1;
-  struct data_t *val = bpf_map_lookup_elem(inner, p);
+  struct data_t *val = NULL;
   bool fromSourceCheck = true;
 
-  struct file *file_p = get_task_file(t);
-  if (file_p == NULL)
-    fromSourceCheck = false;
-  bufs_t *src_buf = get_buf(PATH_BUFFER);
-  if (src_buf == NULL)
-    fromSourceCheck = false;
-  struct path f_src = BPF_CORE_READ(file_p, f_path);
-  if (!prepend_path(&f_src, src_buf))
-    fromSourceCheck = false;
-
-  u32 *src_offset = get_buf_off(PATH_BUFFER);
-  if (src_offset == NULL)
+  struct exe_cache *exe = NULL;
+  if (has_from_source_rules(hdr, NET_CLASS))
+    exe = get_current_exe();
+  if (exe == NULL)
     fromSourceCheck = false;
-
-  void *ptr = &src_buf->buf[*src_offset];
+  else
+    bpf_probe_read_str(p->source, MAX_STRING_SIZE, exe->path);
 
   if (type == SOCK_STREAM && (protocol == IPPROTO_TCP || protocol == 0)) {
     p0 = sock_proto;
@@ -344,12 +286,11 @@ static inline int match_net_rules(int type, int protocol, u32 eventID) {
     p1 = protocol;
   }
 
-  if (fromSourceCheck) {
-    bpf_probe_read_str(p->source, MAX_STRING_SIZE, ptr);
+  if (fromSourceCheck && exe) {
     p->path[0] = p0;
     p->path[1] = p1;
     bpf_probe_read_str(store->source, MAX_STRING_SIZE, p->source);
-    val = bpf_map_lookup_elem(inner, p);
+    val = lookup_rule(inner, &okey, p, rule_hash(p->path), exe->hash);
     if (val) {
       match = true;
       goto decision;
@@ -360,7 +301,7 @@ static inline int match_net_rules(int type, int protocol, u32 eventID) {
   p->path[0] = p0;
   p->path[1] = p1;
 
-  val = bpf_map_lookup_elem(inner, p);
+  val = lookup_rule(inner, &okey, p, rule_hash(p->path), EMPTY_HASH);
 
   if (val) {
     match = true;
@@ -373,68 +314,206 @@ decision:
   if (match) {
     if (val && (val->processmask & RULE_DENY)) {
       retval = -EPERM;
-      goto ringbuf;
+      goto alert;
     }
   }
 
-  bpf_map_update_elem(&bufk, &one, z, BPF_ANY);
-  p->path[0] = dnet;
+  u8 posture = class_posture(hdr, NET_CLASS, inner, &okey, p, z, one);
 
-  struct data_t *allow = bpf_map_lookup_elem(inner, p);
-
-  if (allow) {
+  if (posture) {
     if (!match) {
-      if (allow->processmask == BLOCK_POSTURE) {
+      if (posture == BLOCK_POSTURE) {
         retval = -EPERM;
       }
-      goto ringbuf;
+      goto alert;
     }
   }
 
   return 0;
 
-ringbuf:
-  task_info = bpf_ringbuf_reserve(&kubearmor_events, sizeof(event), 0);
-  if (!task_info) {
-    return retval;
+alert:
+  // Doing policy enforcement without alert if the ring buffer is full
+  submit_alert(eventID, retval, store->path, store->source);
+  return retval;
+}
+
+static __always_inline char hex_char(u8 c) {
+  return c < 10 ? '0' + c : 'a' + c - 10;
+}
+
+static __always_inline int match_addr_rules(struct sockaddr *address,
+                                            int addrlen, u32 op,
+                                            u32 eventID) {
+  struct task_struct *t = (struct task_struct *)bpf_get_current_task();
+
+  struct outer_key okey;
+  get_outer_key(&okey, t);
+
+  struct container_hdr *hdr =
+      bpf_map_lookup_elem(&kubearmor_container_hdr, &okey);
+  if (hdr && !(hdr->flags & HAS_ADDR_RULES)) {
+    return 0;
+  }
+
+  u32 *addrs = bpf_map_lookup_elem(&kubearmor_net_rules, &okey);
+  if (!addrs) {
+    return 0;
   }
-  // Clearing arrays to avoid garbage values to be parsed
-  __builtin_memset(task_info->data.path, 0, sizeof(task_info->data.path));
-  __builtin_memset(task_info->data.source, 0, sizeof(task_info->data.source));
 
-  init_context(task_info);
-  bpf_probe_read_str(&task_info->data.path, MAX_STRING_SIZE, store->path);
-  bpf_probe_read_str(&task_info->data.source, MAX_STRING_SIZE, store->source);
+  struct net_addr_key key = {};
+  u16 port;
+  u32 addr_len;
+
+  // addrlen comes from userspace, a negative length must not pass the size
+  // checks below through the unsigned comparison
+  if (addrlen <= 0)
+    return 0;
+
+  u16 family = BPF_CORE_READ(address, sa_family);
+  if (family == AF_INET && (u32)addrlen >= sizeof(struct sockaddr_in)) {
+    struct sockaddr_in sin;
+    bpf_probe_read_kernel(&sin, sizeof(sin), address);
+    port = bpf_ntohs(sin.sin_port);
+    __builtin_memcpy(key.addr, &sin.sin_addr, 4);
+    addr_len = 4;
+  } else if (family == AF_INET6 &&
+             (u32)addrlen >= offsetof(struct sockaddr_in6, sin6_scope_id)) {
+    // the kernel accepts RFC 2133 addresses without sin6_scope_id, so only
+    // the fields up to the address are read
+    struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)address;
+    struct in6_addr in6;
+    bpf_probe_read_kernel(&port, sizeof(port), &sin6->sin6_port);
+    bpf_probe_read_kernel(&in6, sizeof(in6), &sin6->sin6_addr);
+    port = bpf_ntohs(port);
+
+    u32 *a = in6.in6_u.u6_addr32;
+    if (a[0] == 0 && a[1] == 0 && a[2] == bpf_htonl(0x0000ffff)) {
+      // IPv4-mapped addresses (::ffff:a.b.c.d) reach IPv4 peers through a
+      // dual stack socket, so they are matched by the IPv4 rules
+      family = AF_INET;
+      __builtin_memcpy(key.addr, &a[3], 4);
+      addr_len = 4;
+    } else {
+      __builtin_memcpy(key.addr, &in6, 16);
+      addr_len = 16;
+    }
+  } else {
+    return 0;
+  }
 
-  task_info->event_id = eventID;
+  key.op = op;
+  key.family = family;
+  key.prefixlen = (2 + addr_len) * 8;
 
-  task_info->retval = retval;
-  bpf_ringbuf_submit(task_info, 0);
+  struct data_t *rule = NULL;
+  struct net_addr_val *val = bpf_map_lookup_elem(addrs, &key);
+  if (val) {
+    for (int i = 0; i < MAX_NET_PORT_RANGES; i++) {
+      if (i >= val->count)
+        break;
+      if (port >= val->ports[i].lo && port <= val->ports[i].hi) {
+        rule = &val->ports[i].rule;
+        break;
+      }
+    }
+  }
+
+  int retval = 0;
+  if (rule) {
+    if (!(rule->processmask & RULE_DENY))
+      return 0;
+    retval = -EPERM;
+  } else {
+    // without a header there is no allow rule to default to
+    if (!hdr || op >= NET_ADDR_OPS || !hdr->addr_posture[op])
+      return 0;
+    if (hdr->addr_posture[op] == BLOCK_POSTURE)
+      retval = -EPERM;
+  }
+
+  u32 zero = 0;
+  bufs_k *z = bpf_map_lookup_elem(&bufk, &zero);
+  if (z == NULL)
+    return retval;
+
+  u32 one = 1;
+  bufs_k *p = bpf_map_lookup_elem(&bufk, &one);
+  if (p == NULL)
+    return retval;
+
+  bpf_map_update_elem(&bufk, &one, z, BPF_ANY);
+
+  // The address goes to userspace as hex digits behind the family, alerts
+  // carry NUL terminated strings
+  p->path[0] = sock_addr;
+  p->path[1] = family;
+  p->path[2] = hex_char(port >> 12);
+  p->path[3] = hex_char((port >> 8) & 0xf);
+  p->path[4] = hex_char((port >> 4) & 0xf);
+  p->path[5] = hex_char(port & 0xf);
+  for (int i = 0; i < 16; i++) {
+    if (i >= addr_len)
+      break;
+    p->path[6 + 2 * i] = hex_char(key.addr[i] >> 4);
+    p->path[7 + 2 * i] = hex_char(key.addr[i] & 0xf);
+  }
+
+  struct exe_cache *exe = get_current_exe();
+  if (exe)
+    bpf_probe_read_str(p->source, MAX_STRING_SIZE, exe->path);
+
+  // Doing policy enforcement without alert if the ring buffer is full
+  submit_alert(eventID, retval, p->path, p->source);
   return retval;
 }
 
 SEC("lsm/socket_create")
 int BPF_PROG(enforce_net_create, int family, int type, int protocol) {
-  return match_net_rules(type, protocol, _SOCKET_CREATE);
+  STATS_START();
+  int ret = match_net_rules(type, protocol, _SOCKET_CREATE);
+  STATS_RECORD(_SOCKET_CREATE, ret);
+  return ret;
 }
 
 #define LSM_NET(name, ID)                                                      \
   int BPF_PROG(name, struct socket *sock) {                                    \
     int type = sock->type;                                                     \
     int protocol = sock->sk->sk_protocol;                                      \
-    return match_net_rules(type, protocol, ID);                                \
+    STATS_START();                                                             \
+    int ret = match_net_rules(type, protocol, ID);                             \
+    STATS_RECORD(ID, ret);                                                     \
+    return ret;                                                                \
   }
 
 SEC("lsm/socket_connect")
-LSM_NET(enforce_net_connect, _SOCKET_CONNECT);
+int BPF_PROG(enforce_net_connect, struct socket *sock, struct sockaddr *address,
+             int addrlen) {
+  int type = sock->type;
+  int protocol = sock->sk->sk_protocol;
+  STATS_START();
+  int ret = match_net_rules(type, protocol, _SOCKET_CONNECT);
+  if (ret == 0)
+    ret = match_addr_rules(address, addrlen, NET_ADDR_CONNECT, _SOCKET_CONNECT);
+  STATS_RECORD(_SOCKET_CONNECT, ret);
+  return ret;
+}
+
+SEC("lsm/socket_bind")
+int BPF_PROG(enforce_net_bind, struct socket *sock, struct sockaddr *address,
+             int addrlen) {
+  STATS_START();
+  int ret = match_addr_rules(address, addrlen, NET_ADDR_BIND, _SOCKET_BIND);
+  STATS_RECORD(_SOCKET_BIND, ret);
+  return ret;
+}
 
 SEC("lsm/socket_accept")
 LSM_NET(enforce_net_accept, _SOCKET_ACCEPT);
 
 SEC("lsm/file_open")
 int BPF_PROG(enforce_file, struct file *file) { // check if ret code available
-  struct path f_path = BPF_CORE_READ(file, f_path);
-  return match_and_enforce_path_hooks(&f_path, dfileread, _FILE_OPEN);
+  // bpf_d_path needs the path of the file itself rather than a copy
+  return match_and_enforce_path_hooks(&file->f_path, dfileread, _FILE_OPEN);
 }
 
 SEC("lsm/file_permission")
@@ -445,14 +524,74 @@ int BPF_PROG(enforce_file_perm, struct file *file, int mask) {
     return 0;
   }
 
-  struct path f_path = BPF_CORE_READ(file, f_path);
-  return match_and_enforce_path_hooks(&f_path, dfilewrite, _FILE_PERMISSION);
+  // file_permission fires on every write, the verdict is kept per open file
+  STATS_START();
+  int ret = match_path_rules(&file->f_path, file, dfilewrite, _FILE_PERMISSION);
+  STATS_RECORD(_FILE_PERMISSION, ret);
+  return ret;
+}
+
+SEC("lsm/file_free_security")
+int BPF_PROG(free_file_verdict, struct file *file) {
+  u64 fkey = (u64)file;
+  bpf_map_delete_elem(&kubearmor_file_verdicts, &fkey);
+  return 0;
+}
+
+/* Verdict of the capability rules without fromSource, which userspace
+   compiles into the bitmasks of the container header. 1 means the
+   capability is audited by the posture */
+static __always_inline int cap_mask_verdict(struct container_hdr *hdr,
+                                            int cap) {
+  u64 bit = 1ULL << cap;
+
+  if (hdr->cap_deny & bit)
+    return -EPERM;
+  if (hdr->cap_allow & bit)
+    return 0;
+  if (hdr->posture[CAP_CLASS] == BLOCK_POSTURE)
+    return -EPERM;
+  if (hdr->posture[CAP_CLASS] == AUDIT_POSTURE)
+    return 1;
+  return 0;
+}
+
+static __always_inline void cap_alert(int cap, int retval) {
+  u32 zero = 0;
+  bufs_k *z = bpf_map_lookup_elem(&bufk, &zero);
+  if (z == NULL)
+    return;
+
+  u32 one = 1;
+  bufs_k *p = bpf_map_lookup_elem(&bufk, &one);
+  if (p == NULL)
+    return;
+
+  bpf_map_update_elem(&bufk, &one, z, BPF_ANY);
+  p->path[0] = CAPABLE_KEY;
+  p->path[1] = cap;
+
+  struct exe_cache *exe = get_current_exe();
+  if (exe)
+    bpf_probe_read_str(p->source, MAX_STRING_SIZE, exe->path);
+
+  // Doing policy enforcement without alert if the ring buffer is full
+  submit_alert(_CAPABLE, retval, p->path, p->source);
 }
-SEC("lsm/capable")
-int BPF_PROG(enforce_cap, const struct cred *cred, struct user_namespace *ns,
-             int cap, int ret) {
 
-  event *task_info;
+static __always_inline int match_cap_mask(struct container_hdr *hdr,
+                                          int cap) {
+  int verdict = cap_mask_verdict(hdr, cap);
+  if (verdict == 0)
+    return 0;
+
+  int retval = verdict < 0 ? verdict : 0;
+  cap_alert(cap, retval);
+  return retval;
+}
+
+static __always_inline int match_cap_rules(int cap) {
+
   int retval = 0;
 
   struct task_struct *t = (struct task_struct *)bpf_get_current_task();
@@ -462,6 +601,18 @@ int BPF_PROG(enforce_cap, const struct cred *cred, struct user_namespace *ns,
   struct outer_key okey;
   get_outer_key(&okey, t);
 
+  struct container_hdr *hdr =
+      bpf_map_lookup_elem(&kubearmor_container_hdr, &okey);
+  if (!has_rules(hdr, CAP_CLASS)) {
+    return 0;
+  }
+
+  // Without rules qualified with fromSource the header is all we need
+  bool use_mask = hdr && cap >= 0 && cap < 64;
+  if (use_mask && !has_from_source_rules(hdr, CAP_CLASS)) {
+    return match_cap_mask(hdr, cap);
+  }
+
   u32 *inner = bpf_map_lookup_elem(&kubearmor_containers, &okey);
 
   if (!inner) {
@@ -486,33 +637,24 @@ int BPF_PROG(enforce_cap, const struct cred *cred, struct user_namespace *ns,
   bpf_map_update_elem(&bufk, &one, z, BPF_ANY);
   int p0;
   int p1;
-  struct data_t *val = bpf_map_lookup_elem(inner, p);
+  struct data_t *val = NULL;
   bool fromSourceCheck = true;
 
-  struct file *file_p = get_task_file(t);
-  if (file_p == NULL)
+  struct exe_cache *exe = NULL;
+  if (has_from_source_rules(hdr, CAP_CLASS))
+    exe = get_current_exe();
+  if (exe == NULL)
     fromSourceCheck = false;
-  bufs_t *src_buf = get_buf(PATH_BUFFER);
-  if (src_buf == NULL)
-    fromSourceCheck = false;
-  struct path f_src = BPF_CORE_READ(file_p, f_path);
-  if (!prepend_path(&f_src, src_buf))
-    fromSourceCheck = false;
-
-  u32 *src_offset = get_buf_off(PATH_BUFFER);
-  if (src_offset == NULL)
-    fromSourceCheck = false;
-
-  void *ptr = &src_buf->buf[*src_offset];
+  else
+    bpf_probe_read_str(p->source, MAX_STRING_SIZE, exe->path);
   p0 = CAPABLE_KEY;
   p1 = cap;
 
-  if (fromSourceCheck) {
-    bpf_probe_read_str(p->source, MAX_STRING_SIZE, ptr);
+  if (fromSourceCheck && exe) {
     bpf_probe_read_str(store->source, MAX_STRING_SIZE, p->source);
     p->path[0] = p0;
     p->path[1] = p1;
-    val = bpf_map_lookup_elem(inner, p);
+    val = lookup_rule(inner, &okey, p, rule_hash(p->path), exe->hash);
 
     if (val) {
       match = true;
@@ -520,12 +662,17 @@ int BPF_PROG(enforce_cap, const struct cred *cred, struct user_namespace *ns,
     }
   }
 
+  // the rules without fromSource are in the header as well
+  if (use_mask) {
+    return match_cap_mask(hdr, cap);
+  }
+
   bpf_map_update_elem(&bufk, &one, z, BPF_ANY);
   // check for rules without fromsource
   p->path[0] = p0;
   p->path[1] = p1;
 
-  val = bpf_map_lookup_elem(inner, p);
+  val = lookup_rule(inner, &okey, p, rule_hash(p->path), EMPTY_HASH);
 
   if (val) {
     match = true;
@@ -537,41 +684,42 @@ decision:
   if (match) {
     if (val && (val->processmask & RULE_DENY)) {
       retval = -EPERM;
-      goto ringbuf;
+      goto alert;
     }
   }
 
-  bpf_map_update_elem(&bufk, &one, z, BPF_ANY);
-  p->path[0] = dcap;
-  struct data_t *allow = bpf_map_lookup_elem(inner, p);
+  u8 posture = class_posture(hdr, CAP_CLASS, inner, &okey, p, z, one);
 
-  if (allow) {
+  if (posture) {
     if (!match) {
-      if (allow->processmask == BLOCK_POSTURE) {
+      if (posture == BLOCK_POSTURE) {
         retval = -EPERM;
       }
-      goto ringbuf;
+      goto alert;
     }
   }
 
   return 0;
 
-ringbuf:
-  task_info = bpf_ringbuf_reserve(&kubearmor_events, sizeof(event), 0);
-  if (!task_info) {
-    return retval;
-  }
-  // Clearing arrays to avoid garbage values to be parsed
-  __builtin_memset(task_info->data.path, 0, sizeof(task_info->data.path));
-  __builtin_memset(task_info->data.source, 0, sizeof(task_info->data.source));
-
-  init_context(task_info);
-  bpf_probe_read_str(&task_info->data.path, MAX_STRING_SIZE, store->path);
-  bpf_probe_read_str(&task_info->data.source, MAX_STRING_SIZE, store->source);
-
-  task_info->event_id = _CAPABLE;
+alert:
+  // Doing policy enforcement without alert if the ring buffer is full
+  submit_alert(_CAPABLE, retval, store->path, store->source);
+  return retval;
+}
 
-  task_info->retval = retval;
-  bpf_ringbuf_submit(task_info, 0);
+SEC("lsm/capable")
+int BPF_PROG(enforce_cap, const struct cred *cred, struct user_namespace *ns,
+             int cap, int ret) {
+  STATS_START();
+  int retval = match_cap_rules(cap);
+  STATS_RECORD(_CAPABLE, retval);
   return retval;
-}
\ No newline at end of file
+}
+
+// The executable of the task changed, drop its cached path
+SEC("lsm/bprm_committed_creds")
+int BPF_PROG(invalidate_exe_cache, struct linux_binprm *bprm) {
+  if (exe_cache_enabled)
+    bpf_task_storage_delete(&kubearmor_exe_cache, bpf_get_current_task_btf());
+  return 0;
+}
@@ -5,20 +5,37 @@
 #include "shared.h"
 #include "syscalls.h"
 
-#define PATH_SEC_CALL(NAME , ID)                                                    \
+/* Paths of everything below a renamed directory change, drop the whole
+   resolved path cache by moving on to the next generation */
+static __always_inline void path_cache_bump(void) {
+  u32 zero = 0;
+  u64 *gen = bpf_map_lookup_elem(&kubearmor_path_gen, &zero);
+  if (gen && *gen)
+    __sync_fetch_and_add(gen, 1);
+}
+
+static __always_inline void path_cache_drop(struct path *p) {
+  struct path_cache_key key = {.dentry = (u64)p->dentry, .mnt = (u64)p->mnt};
+  bpf_map_delete_elem(&kubearmor_path_cache, &key);
+}
+
+#define PATH_SEC_CALL(NAME, ID, DROP)                                          \
   SEC("lsm/path_" #NAME)                                                       \
   int BPF_PROG(enforce_##NAME, struct path *dir, struct dentry *dentry) {      \
     struct path f_path;                                                        \
     f_path.dentry = dentry;                                                    \
     f_path.mnt = BPF_CORE_READ(dir, mnt);                                      \
-    return match_and_enforce_path_hooks(&f_path, dpath, ID);                       \
+    int ret = match_and_enforce_path_hooks(&f_path, dpath, ID);                \
+    if (DROP)                                                                  \
+      path_cache_drop(&f_path);                                                \
+    return ret;                                                                \
   }
 
-PATH_SEC_CALL(mknod , _FILE_MKNOD)
-PATH_SEC_CALL(rmdir , _FILE_RMDIR)
-PATH_SEC_CALL(unlink , _FILE_UNLINK)
-PATH_SEC_CALL(symlink , _FILE_SYMLINK)
-PATH_SEC_CALL(mkdir , _FILE_MKDIR)
+PATH_SEC_CALL(mknod, _FILE_MKNOD, false)
+PATH_SEC_CALL(rmdir, _FILE_RMDIR, true)
+PATH_SEC_CALL(unlink, _FILE_UNLINK, true)
+PATH_SEC_CALL(symlink, _FILE_SYMLINK, false)
+PATH_SEC_CALL(mkdir, _FILE_MKDIR, false)
 
 SEC("lsm/path_link")
 int BPF_PROG(enforce_link_src, struct dentry *old_dentry, struct path *dir,
@@ -44,6 +61,7 @@ int BPF_PROG(enforce_rename_old, struct path *old_dir,
   struct path f_path;
   f_path.dentry = old_dentry;
   f_path.mnt = BPF_CORE_READ(old_dir, mnt);
+  path_cache_bump();
   return match_and_enforce_path_hooks(&f_path, dpath , _FILE_RENAME);
 }
 
@@ -57,6 +75,16 @@ int BPF_PROG(enforce_rename_new, struct path *old_dir,
   return match_and_enforce_path_hooks(&f_path, dpath ,_FILE_RENAME);
 }
 
+// Bump the generation again once the rename is done so that paths resolved
+// while the rename was in progress are not served from the cache. Userspace
+// also attaches this program to the mount, unmount and mount move functions,
+// which change the paths below the mountpoint without a rename
+SEC("fexit/vfs_rename")
+int BPF_PROG(invalidate_rename) {
+  path_cache_bump();
+  return 0;
+}
+
 SEC("lsm/path_chmod")
 int BPF_PROG(enforce_chmod, struct path *p) {
   return match_and_enforce_path_hooks(p, dpath , _FILE_CHMOD);
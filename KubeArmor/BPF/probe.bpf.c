@@ -4,6 +4,7 @@
 
 #include "vmlinux.h"
 #include <bpf/bpf_helpers.h>
+#include <bpf/bpf_tracing.h>
 
 char LICENSE[] SEC("license") = "Dual BSD/GPL";
 
@@ -33,4 +34,23 @@ int test_memfd() {
   bpf_ringbuf_submit(task_info, 0);
 
   return 0;
-}
\ No newline at end of file
+}
+
+// Only load if bpf_d_path is allowed in the file hooks of the enforcer
+SEC("lsm/file_open")
+int BPF_PROG(test_dpath_open, struct file *file) {
+  char buf[64];
+
+  bpf_d_path(&file->f_path, buf, sizeof(buf));
+
+  return 0;
+}
+
+SEC("lsm/file_permission")
+int BPF_PROG(test_dpath_perm, struct file *file, int mask) {
+  char buf[64];
+
+  bpf_d_path(&file->f_path, buf, sizeof(buf));
+
+  return 0;
+}
@@ -19,9 +19,11 @@ char LICENSE[] SEC("license") = "Dual BSD/GPL";
 #define MAX_BUFFERS 1
 #define PATH_BUFFER 0
 #define TASK_COMM_LEN 80
+#define ALERT_COMM_LEN 16
 #define AUDIT_POSTURE 140
 #define BLOCK_POSTURE 141
 #define CAPABLE_KEY 200
+#define MAX_DIR_LEN 252
 
 enum file_hook_type { dpath = 0, dfileread, dfilewrite };
 
@@ -33,7 +35,8 @@ enum deny_by_default {
 }; // check if the list is whitelist/blacklist
 enum network_check_type {
   sock_type = 2,
-  sock_proto
+  sock_proto,
+  sock_addr
 }; // configure to check for network protocol or socket type
 
 typedef struct buffers {
@@ -72,12 +75,29 @@ struct {
   __uint(max_entries, 3);
 } bufk SEC(".maps");
 
+// LPM key for directory rules, data is the source hash followed by the
+// directory prefix so that rules with and without fromSource never overlap
+struct dir_key {
+  u32 prefixlen;
+  u32 source;
+  char path[MAX_DIR_LEN];
+};
+
+struct {
+  __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+  __type(key, u32);
+  __type(value, struct dir_key);
+  __uint(max_entries, 1);
+} dirk SEC(".maps");
+
 struct outer_key {
   u32 pid_ns;
   u32 mnt_ns;
 };
 
-typedef struct {
+// Alert header, followed by path_len bytes of path and source_len bytes of
+// source so that alerts are only as large as the strings they carry
+struct alert_hdr {
   u64 ts;
 
   u32 pid_id;
@@ -93,10 +113,51 @@ typedef struct {
   u32 event_id;
   s64 retval;
 
-  u8 comm[TASK_COMM_LEN];
+  u8 comm[ALERT_COMM_LEN];
+
+  u16 path_len;
+  u16 source_len;
+  // alerts of the same kind folded into this one during the last window
+  u32 repeat;
+};
+
+struct alert {
+  struct alert_hdr hdr;
+  char data[2 * MAX_STRING_SIZE];
+};
+
+struct {
+  __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+  __type(key, u32);
+  __type(value, struct alert);
+  __uint(max_entries, 1);
+} alert_buf SEC(".maps");
+
+// Alerts of the same kind are sent once per window, repeats inside the window
+// are only counted and reported with the next alert sent, or by userspace
+// once the window expired, which deletes the entry. 0 disables it
+const volatile u64 alert_dedup_window = 0;
+
+struct alert_dedup_key {
+  struct outer_key okey;
+  u32 event_id;
+  s32 retval;
+  u64 path;
+  u64 source;
+};
+
+struct alert_dedup_val {
+  u64 count;
+  u64 first;
+  u64 last;
+};
 
-  bufs_k data;
-} event;
+struct {
+  __uint(type, BPF_MAP_TYPE_LRU_HASH);
+  __type(key, struct alert_dedup_key);
+  __type(value, struct alert_dedup_val);
+  __uint(max_entries, 4096);
+} kubearmor_alert_dedup SEC(".maps");
 
 struct {
   __uint(type, BPF_MAP_TYPE_RINGBUF);
@@ -104,13 +165,122 @@ struct {
   __uint(pinning, LIBBPF_PIN_BY_NAME);
 } kubearmor_events SEC(".maps");
 
+// Run time histograms of the hooks keyed by event id and counters, recorded
+// only when built with -DKUBEARMOR_STATS (BPF2GO_CFLAGS). The maps are always
+// declared so that the generated bindings do not depend on the build
+#define STATS_HIST_BUCKETS 32
+
+struct hook_stats {
+  u64 count;
+  u64 denied;
+  u64 total_ns;
+  // bucket i counts runs that took [2^i, 2^(i+1)) ns
+  u64 hist[STATS_HIST_BUCKETS];
+};
+
+enum stats_counter {
+  STATS_VERDICT_CACHE_HIT = 0,
+  STATS_PATH_CACHE_HIT,
+  STATS_PATH_CACHE_MISS,
+  STATS_ALERT_FOLDED,
+  STATS_ALERT_DROPPED,
+  STATS_FILE_VERDICT_HIT,
+  STATS_COUNTERS
+};
+
+struct {
+  __uint(type, BPF_MAP_TYPE_PERCPU_HASH);
+  __type(key, u32);
+  __type(value, struct hook_stats);
+  __uint(max_entries, 64);
+} kubearmor_hook_stats SEC(".maps");
+
+struct {
+  __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+  __type(key, u32);
+  __type(value, u64);
+  __uint(max_entries, STATS_COUNTERS);
+} kubearmor_stats_counters SEC(".maps");
+
+// Never written, initial value of new kubearmor_hook_stats entries
+struct {
+  __uint(type, BPF_MAP_TYPE_ARRAY);
+  __type(key, u32);
+  __type(value, struct hook_stats);
+  __uint(max_entries, 1);
+} stats_zero SEC(".maps");
+
+#ifdef KUBEARMOR_STATS
+static __always_inline u32 stats_log2(u64 v) {
+  u32 r, shift;
+
+  r = (v > 0xFFFFFFFF) << 5;
+  v >>= r;
+  shift = (v > 0xFFFF) << 4;
+  v >>= shift;
+  r |= shift;
+  shift = (v > 0xFF) << 3;
+  v >>= shift;
+  r |= shift;
+  shift = (v > 0xF) << 2;
+  v >>= shift;
+  r |= shift;
+  shift = (v > 0x3) << 1;
+  v >>= shift;
+  r |= shift;
+  r |= (v >> 1);
+
+  return r;
+}
+
+static __always_inline void stats_record(u32 id, u64 start, int ret) {
+  u64 delta = bpf_ktime_get_ns() - start;
+
+  struct hook_stats *s = bpf_map_lookup_elem(&kubearmor_hook_stats, &id);
+  if (s == NULL) {
+    u32 zero = 0;
+    struct hook_stats *init = bpf_map_lookup_elem(&stats_zero, &zero);
+    if (init == NULL)
+      return;
+    bpf_map_update_elem(&kubearmor_hook_stats, &id, init, BPF_NOEXIST);
+    s = bpf_map_lookup_elem(&kubearmor_hook_stats, &id);
+    if (s == NULL)
+      return;
+  }
+
+  s->count++;
+  s->total_ns += delta;
+  if (ret < 0)
+    s->denied++;
+
+  u32 bucket = stats_log2(delta);
+  if (bucket >= STATS_HIST_BUCKETS)
+    bucket = STATS_HIST_BUCKETS - 1;
+  s->hist[bucket]++;
+}
+
+static __always_inline void stats_inc(u32 counter) {
+  u64 *v = bpf_map_lookup_elem(&kubearmor_stats_counters, &counter);
+  if (v)
+    (*v)++;
+}
+
+#define STATS_START() u64 stats_start = bpf_ktime_get_ns()
+#define STATS_RECORD(ID, RET) stats_record(ID, stats_start, RET)
+#define STATS_INC(COUNTER) stats_inc(COUNTER)
+#else
+#define STATS_START()
+#define STATS_RECORD(ID, RET)
+#define STATS_INC(COUNTER)
+#endif
+
 #define RULE_EXEC 1 << 0
 #define RULE_WRITE 1 << 1
 #define RULE_READ 1 << 2
 #define RULE_OWNER 1 << 3
 #define RULE_DIR 1 << 4
 #define RULE_RECURSIVE 1 << 5
-#define RULE_HINT 1 << 6
+#define RULE_VERIFY 1 << 6
 #define RULE_DENY 1 << 7
 
 #define MASK_WRITE 0x00000002
@@ -122,6 +292,18 @@ struct data_t {
   u8 filemask;
 };
 
+// "self" holds the rule set on the directory itself, "inherit" holds the
+// rule of the closest recursive parent directory which applies when "self"
+// does not, "len" is the length of the directory prefix. "source" is the
+// source path of fromSource rules, the source hash of the key can collide
+struct dir_val {
+  struct data_t self;
+  struct data_t inherit;
+  u16 len;
+  char source[MAX_STRING_SIZE];
+};
+
+// The maps keyed by container are resized by userspace at load time
 struct outer_hash {
   __uint(type, BPF_MAP_TYPE_HASH_OF_MAPS);
   __uint(max_entries, 256);
@@ -131,6 +313,94 @@ struct outer_hash {
 };
 
 struct outer_hash kubearmor_containers SEC(".maps");
+struct outer_hash kubearmor_dir_rules SEC(".maps");
+
+// Rule classes, index of the class posture in the container header
+enum rule_class { PROC_CLASS = 0, FILE_CLASS, NET_CLASS, CAP_CLASS };
+
+#define HAS_RULES(class) (1 << (class))
+#define HAS_FROM_SOURCE_RULES(class) (1 << (4 + (class)))
+#define HAS_ADDR_RULES (1 << 8)
+
+// Operations matched against the address rules
+enum net_addr_op { NET_ADDR_CONNECT = 0, NET_ADDR_BIND, NET_ADDR_OPS };
+
+// Published by userspace next to the container rule maps, hooks return
+// early when the container has no rules of their class
+struct container_hdr {
+  u32 flags;
+  u32 policy_gen;
+  // default posture per rule class, read instead of the whitelist keys
+  u8 posture[4];
+  u8 addr_posture[NET_ADDR_OPS];
+  u8 pad[2];
+  // capabilities denied and allowed by rules without fromSource
+  u64 cap_deny;
+  u64 cap_allow;
+};
+
+struct {
+  __uint(type, BPF_MAP_TYPE_HASH);
+  __type(key, struct outer_key);
+  __type(value, struct container_hdr);
+  __uint(max_entries, 256);
+  __uint(pinning, LIBBPF_PIN_BY_NAME);
+} kubearmor_container_hdr SEC(".maps");
+
+/* False if the container has no rules of the class, a container without a
+   header is treated as having rules of every class */
+static __always_inline bool has_rules(struct container_hdr *hdr, u32 class) {
+  return hdr == NULL || (hdr->flags & HAS_RULES(class));
+}
+
+/* False if none of the rules of the class are qualified with fromSource, the
+   source binary does not need to be resolved then */
+static __always_inline bool has_from_source_rules(struct container_hdr *hdr,
+                                                  u32 class) {
+  return hdr == NULL || (hdr->flags & HAS_FROM_SOURCE_RULES(class));
+}
+
+// Resolved path cache, an entry is only served if the dentry still has the
+// same parent, name and mountpoint and the generation did not change since
+// it was cached. Path hooks bump the generation on rename, generation 0
+// disables the cache
+#define PATH_CACHE_ENTRIES 4096
+
+struct path_cache_key {
+  u64 dentry;
+  u64 mnt;
+};
+
+struct path_cache_val {
+  u64 gen;
+  u64 parent;
+  u64 hash_len;
+  u64 mountpoint;
+  char path[MAX_STRING_SIZE];
+};
+
+struct {
+  __uint(type, BPF_MAP_TYPE_LRU_HASH);
+  __type(key, struct path_cache_key);
+  __type(value, struct path_cache_val);
+  __uint(max_entries, PATH_CACHE_ENTRIES);
+  __uint(pinning, LIBBPF_PIN_BY_NAME);
+} kubearmor_path_cache SEC(".maps");
+
+struct {
+  __uint(type, BPF_MAP_TYPE_ARRAY);
+  __type(key, u32);
+  __type(value, u64);
+  __uint(max_entries, 1);
+  __uint(pinning, LIBBPF_PIN_BY_NAME);
+} kubearmor_path_gen SEC(".maps");
+
+struct {
+  __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+  __type(key, u32);
+  __type(value, struct path_cache_val);
+  __uint(max_entries, 1);
+} pcache SEC(".maps");
 
 static __always_inline bufs_t *get_buf(int idx) {
   return bpf_map_lookup_elem(&bufs, &idx);
@@ -148,66 +418,103 @@ static inline struct mount *real_mount(struct vfsmount *mnt) {
   return container_of(mnt, struct mount, mnt);
 }
 
-static __always_inline bool prepend_path(struct path *path, bufs_t *string_p) {
+// Upper bound of the components walked with bpf_loop, a path of
+// MAX_COMBINED_LENGTH bytes has at most this many components
+#define MAX_PATH_COMPONENTS (MAX_COMBINED_LENGTH / 2)
+// Components walked by the unrolled fallback
+#define MAX_PATH_COMPONENTS_UNROLLED 30
+
+// Set at load time if the kernel has bpf_loop (5.17+), the unrolled walker is
+// used otherwise
+const volatile bool path_loop_enabled = false;
+
+struct prepend_path_ctx {
+  struct dentry *dentry;
+  struct vfsmount *vfsmnt;
+  struct mount *mnt;
+  int offset;
+};
+
+/* Prepends one component of the path to string_p, returns 1 once the walk
+   reached the root or the buffer is full */
+static __always_inline long prepend_path_step(struct prepend_path_ctx *ctx,
+                                              bufs_t *string_p) {
   char slash = '/';
-  char null = '\0';
-  int offset = MAX_COMBINED_LENGTH;
 
-  if (path == NULL || string_p == NULL) {
-    return false;
+  struct dentry *parent = BPF_CORE_READ(ctx->dentry, d_parent);
+  struct dentry *mnt_root = BPF_CORE_READ(ctx->vfsmnt, mnt_root);
+
+  if (ctx->dentry == mnt_root) {
+    struct mount *m = BPF_CORE_READ(ctx->mnt, mnt_parent);
+    if (ctx->mnt != m) {
+      ctx->dentry = BPF_CORE_READ(ctx->mnt, mnt_mountpoint);
+      ctx->mnt = m;
+      ctx->vfsmnt = &m->mnt;
+      return 0;
+    }
+    return 1;
   }
 
-  struct dentry *dentry = path->dentry;
-  struct vfsmount *vfsmnt = path->mnt;
+  if (ctx->dentry == parent) {
+    return 1;
+  }
 
-  struct mount *mnt = real_mount(vfsmnt);
+  // get d_name
+  struct qstr d_name = BPF_CORE_READ(ctx->dentry, d_name);
+
+  int offset = ctx->offset - (d_name.len + 1);
+  if (offset < 0)
+    return 1;
+
+  int sz = bpf_probe_read_str(
+      &(string_p->buf[(offset) & (MAX_COMBINED_LENGTH - 1)]),
+      (d_name.len + 1) & (MAX_COMBINED_LENGTH - 1), d_name.name);
+  if (sz > 1) {
+    bpf_probe_read(
+        &(string_p->buf[(offset + d_name.len) & (MAX_COMBINED_LENGTH - 1)]), 1,
+        &slash);
+    ctx->offset = offset;
+  }
 
-  struct dentry *parent;
-  struct dentry *mnt_root;
-  struct mount *m;
-  struct qstr d_name;
+  ctx->dentry = parent;
+  return 0;
+}
 
-#pragma unroll
-  for (int i = 0; i < 30; i++) {
-    parent = BPF_CORE_READ(dentry, d_parent);
-    mnt_root = BPF_CORE_READ(vfsmnt, mnt_root);
-
-    if (dentry == mnt_root) {
-      m = BPF_CORE_READ(mnt, mnt_parent);
-      if (mnt != m) {
-        dentry = BPF_CORE_READ(mnt, mnt_mountpoint);
-        mnt = BPF_CORE_READ(mnt, mnt_parent);
-        vfsmnt = &mnt->mnt;
-        continue;
-      }
-      break;
-    }
+static long prepend_path_cb(u32 index, void *data) {
+  bufs_t *string_p = get_buf(PATH_BUFFER);
+  if (string_p == NULL)
+    return 1;
 
-    if (dentry == parent) {
-      break;
-    }
+  return prepend_path_step(data, string_p);
+}
 
-    // get d_name
-    d_name = BPF_CORE_READ(dentry, d_name);
+static __always_inline bool prepend_path(struct path *path, bufs_t *string_p) {
+  char slash = '/';
+  char null = '\0';
 
-    offset -= (d_name.len + 1);
-    if (offset < 0)
-      break;
+  if (path == NULL || string_p == NULL) {
+    return false;
+  }
 
-    int sz = bpf_probe_read_str(
-        &(string_p->buf[(offset) & (MAX_COMBINED_LENGTH - 1)]),
-        (d_name.len + 1) & (MAX_COMBINED_LENGTH - 1), d_name.name);
-    if (sz > 1) {
-      bpf_probe_read(
-          &(string_p->buf[(offset + d_name.len) & (MAX_COMBINED_LENGTH - 1)]),
-          1, &slash);
-    } else {
-      offset += (d_name.len + 1);
-    }
+  struct prepend_path_ctx ctx = {
+      .dentry = path->dentry,
+      .vfsmnt = path->mnt,
+      .mnt = real_mount(path->mnt),
+      .offset = MAX_COMBINED_LENGTH,
+  };
 
-    dentry = parent;
+  if (path_loop_enabled) {
+    bpf_loop(MAX_PATH_COMPONENTS, prepend_path_cb, &ctx, 0);
+  } else {
+#pragma unroll
+    for (int i = 0; i < MAX_PATH_COMPONENTS_UNROLLED; i++) {
+      if (prepend_path_step(&ctx, string_p))
+        break;
+    }
   }
 
+  int offset = ctx.offset;
+
   if (offset == MAX_COMBINED_LENGTH) {
     return false;
   }
@@ -221,6 +528,169 @@ static __always_inline bool prepend_path(struct path *path, bufs_t *string_p) {
   return true;
 }
 
+// Set at load time if bpf_d_path is allowed in the file_open and
+// file_permission hooks, paths are rendered by prepend_path otherwise
+const volatile bool d_path_enabled = false;
+
+/* Render the path into dst, served from the resolved path cache when possible.
+   Returns the length including the terminating NUL, 0 if resolution failed */
+static __always_inline long resolve_path(struct path *path, char *dst) {
+  u32 zero = 0;
+
+  if (path == NULL)
+    return 0;
+
+  struct path_cache_key key = {.dentry = (u64)path->dentry,
+                               .mnt = (u64)path->mnt};
+  u64 parent = (u64)BPF_CORE_READ(path->dentry, d_parent);
+  u64 hash_len = BPF_CORE_READ(path->dentry, d_name.hash_len);
+  u64 mountpoint = (u64)BPF_CORE_READ(real_mount(path->mnt), mnt_mountpoint);
+
+  u64 *gen = bpf_map_lookup_elem(&kubearmor_path_gen, &zero);
+  u64 curgen = gen ? *gen : 0;
+
+  if (curgen) {
+    struct path_cache_val *cached =
+        bpf_map_lookup_elem(&kubearmor_path_cache, &key);
+    if (cached && cached->gen == curgen && cached->parent == parent &&
+        cached->hash_len == hash_len && cached->mountpoint == mountpoint) {
+      STATS_INC(STATS_PATH_CACHE_HIT);
+      return bpf_probe_read_str(dst, MAX_STRING_SIZE, cached->path);
+    }
+    STATS_INC(STATS_PATH_CACHE_MISS);
+  }
+
+  bufs_t *path_buf = get_buf(PATH_BUFFER);
+  if (path_buf == NULL)
+    return 0;
+
+  if (!prepend_path(path, path_buf))
+    return 0;
+
+  u32 *path_offset = get_buf_off(PATH_BUFFER);
+  if (path_offset == NULL)
+    return 0;
+
+  long len =
+      bpf_probe_read_str(dst, MAX_STRING_SIZE, &path_buf->buf[*path_offset]);
+  if (len <= 0)
+    return 0;
+
+  if (curgen) {
+    struct path_cache_val *val = bpf_map_lookup_elem(&pcache, &zero);
+    if (val) {
+      val->gen = curgen;
+      val->parent = parent;
+      val->hash_len = hash_len;
+      val->mountpoint = mountpoint;
+      bpf_probe_read_str(val->path, MAX_STRING_SIZE, dst);
+      bpf_map_update_elem(&kubearmor_path_cache, &key, val, BPF_ANY);
+    }
+  }
+
+  return len;
+}
+
+// Set by userspace, rule maps are keyed by struct rule_key instead of bufs_k
+const volatile bool compact_keys = false;
+
+// Random per KubeArmor run so that colliding paths can not be crafted upfront
+const volatile u64 hash_seed = 0;
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+
+// FNV-1a, userspace generates the same hash for rule keys
+static __always_inline u64 hash_str(const char *str) {
+  u64 hash = FNV_OFFSET ^ hash_seed;
+
+  for (int i = 0; i < MAX_STRING_SIZE; i++) {
+    if (str[i] == '\0')
+      break;
+    hash ^= (u8)str[i];
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
+// Hash of the empty string, the source of rules without fromSource
+#define EMPTY_HASH (FNV_OFFSET ^ hash_seed)
+
+/* Hash of a rule key string, only needed with compact keys. Hooks hash the
+   path once and reuse it for all lookups, the hash of the source binary is
+   cached with its path */
+static __always_inline u64 rule_hash(const char *str) {
+  return compact_keys ? hash_str(str) : 0;
+}
+
+// Compact rule key, hashes of path and source of bufs_k
+struct rule_key {
+  u64 path;
+  u64 source;
+};
+
+// Full key of rules whose compact keys collide within a container, the
+// compact entry then only carries RULE_VERIFY
+struct verify_key {
+  struct outer_key okey;
+  bufs_k key;
+};
+
+struct {
+  __uint(type, BPF_MAP_TYPE_HASH);
+  __type(key, struct verify_key);
+  __type(value, struct data_t);
+  __uint(max_entries, 1024);
+  __uint(pinning, LIBBPF_PIN_BY_NAME);
+} kubearmor_rule_verify SEC(".maps");
+
+struct {
+  __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+  __type(key, u32);
+  __type(value, struct verify_key);
+  __uint(max_entries, 1);
+} verifyk SEC(".maps");
+
+/* Lookup a rule in the container rule map, path_hash and source_hash are the
+   hashes of the strings of key and only used with compact keys */
+static __always_inline struct data_t *lookup_rule(void *inner,
+                                                  struct outer_key *okey,
+                                                  bufs_k *key, u64 path_hash,
+                                                  u64 source_hash) {
+  if (!compact_keys)
+    return bpf_map_lookup_elem(inner, key);
+
+  struct rule_key rk = {.path = path_hash, .source = source_hash};
+  struct data_t *val = bpf_map_lookup_elem(inner, &rk);
+  if (val == NULL || !(val->filemask & RULE_VERIFY))
+    return val;
+
+  u32 zero = 0;
+  struct verify_key *vk = bpf_map_lookup_elem(&verifyk, &zero);
+  if (vk == NULL)
+    return NULL;
+  vk->okey = *okey;
+  __builtin_memcpy(&vk->key, key, sizeof(bufs_k));
+
+  return bpf_map_lookup_elem(&kubearmor_rule_verify, vk);
+}
+
+/* Default posture of the class, 0 if the class has no allow rules. It is read
+   from the container header, the whitelist key of the rule map is only looked
+   up for a container whose header is not published yet */
+static __always_inline u8 class_posture(struct container_hdr *hdr, u32 class,
+                                        void *inner, struct outer_key *okey,
+                                        bufs_k *key, bufs_k *z, u32 idx) {
+  if (hdr)
+    return hdr->posture[class & CAP_CLASS];
+
+  bpf_map_update_elem(&bufk, &idx, z, BPF_ANY);
+  key->path[0] = dproc + class;
+  struct data_t *allow =
+      lookup_rule(inner, okey, key, rule_hash(key->path), EMPTY_HASH);
+  return allow ? allow->processmask : 0;
+}
+
 static __always_inline u32 get_task_pid_ns_id(struct task_struct *task) {
   return BPF_CORE_READ(task, nsproxy, pid_ns_for_children, ns).inum;
 }
@@ -253,6 +723,67 @@ static struct file *get_task_file(struct task_struct *task) {
   return BPF_CORE_READ(task, mm, exe_file);
 }
 
+// Set by userspace when the kernel supports task local storage, otherwise
+// kubearmor_exe_cache is loaded as a plain hash map which is never used
+const volatile bool exe_cache_enabled = false;
+
+// Executable of a task, "exe" is the mm->exe_file it was resolved from
+struct exe_cache {
+  u64 exe;
+  u64 hash;
+  char path[MAX_STRING_SIZE];
+};
+
+struct {
+  __uint(type, BPF_MAP_TYPE_TASK_STORAGE);
+  __uint(map_flags, BPF_F_NO_PREALLOC);
+  __type(key, int);
+  __type(value, struct exe_cache);
+  __uint(pinning, LIBBPF_PIN_BY_NAME);
+} kubearmor_exe_cache SEC(".maps");
+
+struct {
+  __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+  __type(key, u32);
+  __type(value, struct exe_cache);
+  __uint(max_entries, 1);
+} exe_scratch SEC(".maps");
+
+/* Path and hash of the executable of the current task, resolved once per
+   exec and kept in task local storage when available */
+static __always_inline struct exe_cache *get_current_exe(void) {
+  struct task_struct *t = (struct task_struct *)bpf_get_current_task();
+  struct exe_cache *cache = NULL;
+  u32 zero = 0;
+
+  struct file *exe = get_task_file(t);
+  if (exe == NULL)
+    return NULL;
+
+  if (exe_cache_enabled) {
+    cache = bpf_task_storage_get(&kubearmor_exe_cache,
+                                 bpf_get_current_task_btf(), 0,
+                                 BPF_LOCAL_STORAGE_GET_F_CREATE);
+    if (cache && cache->exe == (u64)exe)
+      return cache;
+  }
+
+  if (cache == NULL)
+    cache = bpf_map_lookup_elem(&exe_scratch, &zero);
+  if (cache == NULL)
+    return NULL;
+
+  struct path f_src = BPF_CORE_READ(exe, f_path);
+  if (!resolve_path(&f_src, cache->path)) {
+    cache->exe = 0;
+    return NULL;
+  }
+  cache->hash = hash_str(cache->path);
+  cache->exe = (u64)exe;
+
+  return cache;
+}
+
 static inline void get_outer_key(struct outer_key *pokey,
                                  struct task_struct *t) {
   pokey->pid_ns = get_task_pid_ns_id(t);
@@ -265,7 +796,7 @@ static inline void get_outer_key(struct outer_key *pokey,
 
 // == Context Management == //
 
-static __always_inline u32 init_context(event *event_data) {
+static __always_inline u32 init_context(struct alert_hdr *event_data) {
   struct task_struct *task = (struct task_struct *)bpf_get_current_task();
 
   event_data->ts = bpf_ktime_get_ns();
@@ -290,13 +821,126 @@ static __always_inline u32 init_context(event *event_data) {
 
   event_data->uid = bpf_get_current_uid_gid();
 
-  // Clearing array to avoid garbage values
-  __builtin_memset(event_data->comm, 0, sizeof(event_data->comm));
   bpf_get_current_comm(&event_data->comm, sizeof(event_data->comm));
 
   return 0;
 }
 
+/* Sends an alert carrying the given path and source, records are written to
+   the per cpu scratch buffer and copied to the ring buffer at their real size */
+static __always_inline int submit_alert(u32 event_id, s64 retval, char *path,
+                                        char *source) {
+  u32 zero = 0;
+  struct alert *a = bpf_map_lookup_elem(&alert_buf, &zero);
+  if (a == NULL)
+    return 0;
+
+  init_context(&a->hdr);
+  a->hdr.event_id = event_id;
+  a->hdr.retval = retval;
+
+  long path_len = bpf_probe_read_str(a->data, MAX_STRING_SIZE, path);
+  if (path_len < 0)
+    path_len = 0;
+  if (path_len > MAX_STRING_SIZE)
+    path_len = MAX_STRING_SIZE;
+
+  long source_len =
+      bpf_probe_read_str(&a->data[path_len], MAX_STRING_SIZE, source);
+  if (source_len < 0)
+    source_len = 0;
+  if (source_len > MAX_STRING_SIZE)
+    source_len = MAX_STRING_SIZE;
+
+  a->hdr.path_len = path_len;
+  a->hdr.source_len = source_len;
+  a->hdr.repeat = 0;
+
+  if (alert_dedup_window) {
+    struct alert_dedup_key dkey = {};
+    dkey.okey.pid_ns = a->hdr.pid_id;
+    dkey.okey.mnt_ns = a->hdr.mnt_id;
+    dkey.event_id = event_id;
+    dkey.retval = retval;
+    dkey.path = hash_str(path);
+    dkey.source = hash_str(source);
+
+    struct alert_dedup_val *dval =
+        bpf_map_lookup_elem(&kubearmor_alert_dedup, &dkey);
+    if (dval && a->hdr.ts - dval->first < alert_dedup_window) {
+      __sync_fetch_and_add(&dval->count, 1);
+      dval->last = a->hdr.ts;
+      STATS_INC(STATS_ALERT_FOLDED);
+      return 0;
+    }
+
+    // start a new window, the repeats of the previous one go with this alert
+    struct alert_dedup_val nval = {.first = a->hdr.ts, .last = a->hdr.ts};
+    if (dval)
+      a->hdr.repeat = dval->count;
+    bpf_map_update_elem(&kubearmor_alert_dedup, &dkey, &nval, BPF_ANY);
+  }
+
+  u64 size = sizeof(a->hdr) + path_len + source_len;
+  if (size > sizeof(*a))
+    size = sizeof(*a);
+
+  long err = bpf_ringbuf_output(&kubearmor_events, a, size, 0);
+  if (err < 0)
+    STATS_INC(STATS_ALERT_DROPPED);
+  return err;
+}
+
+static __always_inline bool str_equal(const char *a, const char *b) {
+  for (int i = 0; i < MAX_STRING_SIZE; i++) {
+    if (a[i] != b[i])
+      return false;
+    if (a[i] == '\0')
+      break;
+  }
+  return true;
+}
+
+/* Longest prefix match of path against the directory rules of a container,
+   fromSource rules are looked up with the hash of source and only match if
+   their source path is source itself. A NULL source matches the rules without
+   fromSource */
+static __always_inline struct dir_val *
+lookup_dir_rule(void *dirs, struct dir_key *dk, char *path, char *source,
+                u32 source_hash) {
+  dk->source = source ? source_hash : 0;
+  long len = bpf_probe_read_str(dk->path, MAX_DIR_LEN, path);
+  if (len <= 1)
+    return NULL;
+  dk->prefixlen = (sizeof(dk->source) + len - 1) * 8;
+
+  struct dir_val *val = bpf_map_lookup_elem(dirs, dk);
+  if (val && source && !str_equal(val->source, source))
+    return NULL;
+  return val;
+}
+
+/* Pick the rule that applies to a path whose parent directory is parent_len
+   long, a non recursive directory only matches its direct children */
+static __always_inline void resolve_dir_rule(struct dir_val *dirval,
+                                             u32 parent_len,
+                                             struct data_t *rule) {
+  u8 mask;
+
+  rule->processmask = dirval->inherit.processmask;
+  rule->filemask = dirval->inherit.filemask;
+
+  mask = dirval->self.processmask;
+  if ((mask & RULE_DIR) &&
+      ((mask & RULE_RECURSIVE) || dirval->len == parent_len))
+    rule->processmask = mask;
+
+  mask = dirval->self.filemask;
+  if ((mask & RULE_DIR) &&
+      ((mask & RULE_RECURSIVE) || dirval->len == parent_len))
+    rule->filemask = mask;
+}
+
 static bool is_owner(struct file *file_p) {
   kuid_t owner = BPF_CORE_READ(file_p, f_inode, i_uid);
   unsigned int z = bpf_get_current_uid_gid();
@@ -313,11 +957,56 @@ static bool is_owner_path(struct dentry *dent) {
   return true;
 }
 
-static inline int match_and_enforce_path_hooks(struct path *f_path, u32 id,
-                                               u32 eventID) {
-  struct task_struct *t = (struct task_struct *)bpf_get_current_task();
+// Silent pass verdicts of the file hooks, only used while renames invalidate
+// the path cache. A verdict stays valid as long as the container rules
+// (policy generation in the header) and the path of the dentry did not change
+struct verdict_key {
+  struct outer_key okey;
+  u64 dentry;
+  u64 mnt;
+  u64 source;
+  u32 id;
+  u32 pad;
+};
 
-  event *task_info;
+struct verdict_val {
+  u64 path_gen;
+  u64 parent;
+  u64 hash_len;
+  u32 policy_gen;
+};
+
+struct {
+  __uint(type, BPF_MAP_TYPE_LRU_HASH);
+  __type(key, struct verdict_key);
+  __type(value, struct verdict_val);
+  __uint(max_entries, 8192);
+} kubearmor_verdicts SEC(".maps");
+
+// Silent pass verdicts of write checks on open files, keyed by the struct file
+// and dropped when the file is freed. Open files are shared with other
+// containers through fd passing, so a verdict stays valid as long as it is
+// used by the same container and its rules (policy generation in the header),
+// the executable and the path generation did not change. Like the verdicts
+// above they are only used while renames invalidate the path cache
+struct file_verdict {
+  struct outer_key okey;
+  u64 source;
+  u64 path_gen;
+  u32 policy_gen;
+  u32 pad;
+};
+
+struct {
+  __uint(type, BPF_MAP_TYPE_LRU_HASH);
+  __type(key, u64);
+  __type(value, struct file_verdict);
+  __uint(max_entries, 16384);
+} kubearmor_file_verdicts SEC(".maps");
+
+static inline int match_path_rules(struct path *f_path, struct file *file,
+                                   u32 id, u32 eventID) {
+  struct task_struct *t = (struct task_struct *)bpf_get_current_task();
 
   int retval = 0;
 
@@ -332,6 +1021,12 @@ static inline int match_and_enforce_path_hooks(struct path *f_path, u32 id,
     return 0;
   }
 
+  struct container_hdr *hdr =
+      bpf_map_lookup_elem(&kubearmor_container_hdr, &okey);
+  if (!has_rules(hdr, FILE_CLASS)) {
+    return 0;
+  }
+
   // "z" is a zero value map key which is used to reset values of other keys
   // which are inturn used and updated to lookup the Rule Map
 
@@ -359,154 +1054,132 @@ static inline int match_and_enforce_path_hooks(struct path *f_path, u32 id,
   if (pk == NULL)
     return 0;
 
-  /* Extract full path from file structure provided by LSM Hook */
-  bufs_t *path_buf = get_buf(PATH_BUFFER);
-  if (path_buf == NULL)
-    return 0;
+  /* Full path of the source binary of the current task, only needed to match
+     fromSource rules */
+  struct exe_cache *exe = NULL;
+  if (has_from_source_rules(hdr, FILE_CLASS))
+    exe = get_current_exe();
+
+  u64 *path_gen = bpf_map_lookup_elem(&kubearmor_path_gen, &zero);
+
+  u64 fkey = (u64)file;
+  struct file_verdict fval = {};
+  if (file && hdr && path_gen && *path_gen) {
+    fval.okey = okey;
+    fval.source = exe ? exe->hash : 0;
+    fval.path_gen = *path_gen;
+    fval.policy_gen = hdr->policy_gen;
+
+    struct file_verdict *cached =
+        bpf_map_lookup_elem(&kubearmor_file_verdicts, &fkey);
+    if (cached && cached->okey.pid_ns == okey.pid_ns &&
+        cached->okey.mnt_ns == okey.mnt_ns && cached->source == fval.source &&
+        cached->path_gen == fval.path_gen &&
+        cached->policy_gen == fval.policy_gen) {
+      STATS_INC(STATS_FILE_VERDICT_HIT);
+      return 0;
+    }
+  }
 
-  if (!prepend_path(f_path, path_buf))
-    return 0;
+  struct verdict_key vkey = {};
+  struct verdict_val vval = {};
+
+  if (hdr && path_gen && *path_gen) {
+    vkey.okey = okey;
+    vkey.dentry = (u64)BPF_CORE_READ(f_path, dentry);
+    vkey.mnt = (u64)BPF_CORE_READ(f_path, mnt);
+    vkey.source = exe ? exe->hash : 0;
+    vkey.id = id;
+
+    vval.path_gen = *path_gen;
+    vval.parent = (u64)BPF_CORE_READ(f_path, dentry, d_parent);
+    vval.hash_len = BPF_CORE_READ(f_path, dentry, d_name.hash_len);
+    vval.policy_gen = hdr->policy_gen;
+
+    struct verdict_val *cached = bpf_map_lookup_elem(&kubearmor_verdicts, &vkey);
+    if (cached && cached->path_gen == vval.path_gen &&
+        cached->parent == vval.parent && cached->hash_len == vval.hash_len &&
+        cached->policy_gen == vval.policy_gen) {
+      STATS_INC(STATS_VERDICT_CACHE_HIT);
+      return 0;
+    }
+  }
 
-  u32 *path_offset = get_buf_off(PATH_BUFFER);
-  if (path_offset == NULL)
+  /* Extract full path from file structure provided by LSM Hook, bpf_d_path
+     is only allowed in the file hooks */
+  long path_len = 0;
+  if (d_path_enabled && (id == dfileread || id == dfilewrite))
+    path_len = bpf_d_path(f_path, store->path, MAX_STRING_SIZE);
+  if (path_len <= 0)
+    path_len = resolve_path(f_path, store->path);
+  if (path_len <= 0)
     return 0;
 
-  void *path_ptr = &path_buf->buf[*path_offset];
-  bpf_probe_read_str(store->path, MAX_STRING_SIZE, path_ptr);
+  u64 path_hash = rule_hash(store->path);
 
-  struct data_t *val = bpf_map_lookup_elem(inner, store);
-  struct data_t *dirval;
-  bool recursivebuthint = false;
-  bool fromSourceCheck = true;
+  /* Length of the parent directory prefix including the trailing slash,
+     used to match non recursive directory rules */
+  u32 parent_len = path_len - 1 - BPF_CORE_READ(f_path, dentry, d_name.len);
 
-  /* Extract full path of the source binary from the task structure */
-  struct file *file_p = get_task_file(t);
-  if (file_p == NULL)
-    fromSourceCheck = false;
-  bufs_t *src_buf = get_buf(PATH_BUFFER);
-  if (src_buf == NULL)
-    fromSourceCheck = false;
-  struct path f_src = BPF_CORE_READ(file_p, f_path);
-  if (!prepend_path(&f_src, src_buf))
-    fromSourceCheck = false;
-
-  u32 *src_offset = get_buf_off(PATH_BUFFER);
-  if (src_offset == NULL)
-    fromSourceCheck = false;
+  u32 *dirs = bpf_map_lookup_elem(&kubearmor_dir_rules, &okey);
+  struct dir_key *dk = bpf_map_lookup_elem(&dirk, &zero);
+  if (dk == NULL)
+    return 0;
 
-  void *ptr = &src_buf->buf[*src_offset];
+  struct data_t *val = NULL;
+  struct dir_val *dirval;
+  struct data_t dirrule = {};
+  bool fromSourceCheck = true;
 
-  if (fromSourceCheck) {
-    bpf_probe_read_str(store->source, MAX_STRING_SIZE, ptr);
+  if (exe == NULL)
+    fromSourceCheck = false;
+  else
+    bpf_probe_read_str(store->source, MAX_STRING_SIZE, exe->path);
 
-    val = bpf_map_lookup_elem(inner, store);
+  if (fromSourceCheck && exe) {
+    val = lookup_rule(inner, &okey, store, path_hash, exe->hash);
 
     if (val && (val->filemask & RULE_READ)) {
       match = true;
       goto decision;
     }
 
-#pragma unroll
-    for (int i = 0; i < 64; i++) {
-      if (store->path[i] == '\0')
-        break;
-
-      if (store->path[i] == '/') {
-        bpf_map_update_elem(&bufk, &two, z, BPF_ANY);
-
-        match = false;
-
-        bpf_probe_read_str(pk->path, i + 2, store->path);
-        /* Check Subdir with From Source */
-        bpf_probe_read_str(pk->source, MAX_STRING_SIZE, store->source);
-        dirval = bpf_map_lookup_elem(inner, pk);
-        if (dirval) {
-          if ((dirval->filemask & RULE_DIR) && (dirval->filemask & RULE_READ)) {
-            match = true;
-            if ((dirval->filemask &
-                 RULE_RECURSIVE)) { /* true directory match and */
-                                    /* not a hint suggests */
-              /* there are no possibility of child dir */
-              val = dirval;
-              if (dirval->filemask & RULE_HINT) {
-                recursivebuthint = true;
-                continue;
-              } else {
-                goto decision;
-              }
-            } else {
-              continue; /* We continue the loop to see if we have more nested
-                         */
-                        /* directories and set match to false */
-            }
-          }
-        } else {
-          break;
+    /* Check Subdir with From Source */
+    if (dirs) {
+      dirval = lookup_dir_rule(dirs, dk, store->path, exe->path,
+                               (u32)exe->hash);
+      if (dirval) {
+        resolve_dir_rule(dirval, parent_len, &dirrule);
+        if ((dirrule.filemask & RULE_DIR) && (dirrule.filemask & RULE_READ)) {
+          match = true;
+          val = &dirrule;
+          goto decision;
         }
       }
     }
-
-    if (recursivebuthint) {
-      match = true;
-      goto decision;
-    }
-    if (match) {
-      if (dirval) { /* to please the holy verifier */
-        val = dirval;
-        goto decision;
-      }
-    }
   }
   bpf_map_update_elem(&bufk, &two, z, BPF_ANY);
   bpf_probe_read_str(pk->path, MAX_STRING_SIZE, store->path);
 
-  val = bpf_map_lookup_elem(inner, pk);
+  val = lookup_rule(inner, &okey, pk, path_hash, EMPTY_HASH);
 
   if (val && (val->filemask & RULE_READ)) {
     match = true;
     goto decision;
   }
 
-  recursivebuthint = false;
-
-#pragma unroll
-  for (int i = 0; i < 64; i++) {
-    if (store->path[i] == '\0')
-      break;
-
-    if (store->path[i] == '/') {
-      bpf_map_update_elem(&bufk, &two, z, BPF_ANY);
-      match = false;
-      bpf_probe_read_str(pk->path, i + 2, store->path);
-      dirval = bpf_map_lookup_elem(inner, pk);
-      if (!dirval) {
-        break;
-      }
-      if ((dirval->filemask & RULE_DIR) && (dirval->filemask & RULE_READ)) {
+  if (dirs) {
+    dirval = lookup_dir_rule(dirs, dk, store->path, NULL, 0);
+    if (dirval) {
+      resolve_dir_rule(dirval, parent_len, &dirrule);
+      if ((dirrule.filemask & RULE_DIR) && (dirrule.filemask & RULE_READ)) {
         match = true;
-        if (!(dirval->filemask & RULE_RECURSIVE)) {
-          continue; /* continue the loop to see if we have more nested dirs */
-        }
-        /* true directory match and not a hint suggests */
-        /* there are no possibility of child dir */
-        val = dirval;
-        if (dirval->filemask & RULE_HINT) {
-          recursivebuthint = true;
-          continue;
-        }
+        val = &dirrule;
         goto decision;
       }
     }
   }
 
-  if (recursivebuthint) {
-    match = true;
-    goto decision;
-  } else if (match && dirval) {
-    val = dirval;
-    goto decision;
-  }
-
 decision:
 
   if (id == dpath) { // Path Hooks
@@ -524,19 +1197,17 @@ decision:
     }
 
     if (retval == -EPERM) {
-      goto ringbuf;
+      goto alert;
     }
 
-    bpf_map_update_elem(&bufk, &two, z, BPF_ANY);
-    pk->path[0] = dfile;
-    struct data_t *allow = bpf_map_lookup_elem(inner, pk);
+    u8 posture = class_posture(hdr, FILE_CLASS, inner, &okey, pk, z, two);
 
-    if (allow) {
+    if (posture) {
       if (!match) {
-        if (allow->processmask == BLOCK_POSTURE) {
+        if (posture == BLOCK_POSTURE) {
           retval = -EPERM;
         }
-        goto ringbuf;
+        goto alert;
       }
     }
 
@@ -551,7 +1222,7 @@ decision:
       }
       if (val && (val->filemask & RULE_READ) && !(val->filemask & RULE_WRITE)) {
         // Read Only Policy, Decision making will be done in lsm/file_permission
-        return 0;
+        goto verdict;
       }
       if (val && (val->filemask & RULE_DENY)) {
         retval = -EPERM;
@@ -559,66 +1230,60 @@ decision:
     }
 
     if (retval == -EPERM) {
-      goto ringbuf;
+      goto alert;
     }
 
-    bpf_map_update_elem(&bufk, &two, z, BPF_ANY);
-    pk->path[0] = dfile;
-    struct data_t *allow = bpf_map_lookup_elem(inner, pk);
+    u8 posture = class_posture(hdr, FILE_CLASS, inner, &okey, pk, z, two);
 
-    if (allow) {
+    if (posture) {
       if (!match) {
-        if (allow->processmask == BLOCK_POSTURE) {
+        if (posture == BLOCK_POSTURE) {
           retval = -EPERM;
         }
-        goto ringbuf;
+        goto alert;
       }
     }
   } else if (id == dfilewrite) { // file write
     if (match) {
       if (val && (val->filemask & RULE_DENY)) {
         retval = -EPERM;
-        goto ringbuf;
+        goto alert;
       }
     }
 
-    bpf_map_update_elem(&bufk, &two, z, BPF_ANY);
-    pk->path[0] = dfile;
-    struct data_t *allow = bpf_map_lookup_elem(inner, pk);
+    u8 posture = class_posture(hdr, FILE_CLASS, inner, &okey, pk, z, two);
 
-    if (allow) {
+    if (posture) {
       if (!match) {
-        if (allow->processmask == BLOCK_POSTURE) {
+        if (posture == BLOCK_POSTURE) {
           retval = -EPERM;
         }
-        goto ringbuf;
+        goto alert;
       }
     }
   }
 
+verdict:
+  if (vval.path_gen)
+    bpf_map_update_elem(&kubearmor_verdicts, &vkey, &vval, BPF_ANY);
+  if (fval.path_gen)
+    bpf_map_update_elem(&kubearmor_file_verdicts, &fkey, &fval, BPF_ANY);
   return 0;
 
-ringbuf:
-  task_info = bpf_ringbuf_reserve(&kubearmor_events, sizeof(event), 0);
-  if (!task_info) {
-    // Failed to reserve, doing policy enforcement without alert
-    return retval;
-  }
-
-  init_context(task_info);
-  // Clearing arrays to avoid garbage values
-  __builtin_memset(task_info->data.path, 0, sizeof(task_info->data.path));
-  __builtin_memset(task_info->data.source, 0, sizeof(task_info->data.source));
-
-  bpf_probe_read_str(&task_info->data.path, MAX_STRING_SIZE, store->path);
-  bpf_probe_read_str(&task_info->data.source, MAX_STRING_SIZE, store->source);
-
-  task_info->event_id = eventID;
-  task_info->retval = retval;
-  bpf_ringbuf_submit(task_info, 0);
+alert:
+  // Doing policy enforcement without alert if the ring buffer is full
+  submit_alert(eventID, retval, store->path, store->source);
   return retval;
 }
 
+static inline int match_and_enforce_path_hooks(struct path *f_path, u32 id,
+                                               u32 eventID) {
+  STATS_START();
+  int ret = match_path_rules(f_path, NULL, id, eventID);
+  STATS_RECORD(eventID, ret);
+  return ret;
+}
+
 /*
   How do we check what to deny or not?
 
@@ -257,7 +257,17 @@ typedef struct __attribute__((__packed__)) sys_context
 #define BPF_PERF_OUTPUT(_name) \
     BPF_MAP(_name, BPF_MAP_TYPE_PERF_EVENT_ARRAY, int, __u32, 1024)
 
-BPF_LRU_HASH(pid_ns_map, u32, u32);
+#define BPF_RINGBUF_OUTPUT(_name, _size) \
+    struct { \
+        __uint(type, BPF_MAP_TYPE_RINGBUF); \
+        __uint(max_entries, _size); \
+    } _name SEC(".maps");
+
+// Events go to a single ring buffer shared by all CPUs if the kernel has them
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 8, 0)
+#define RINGBUF_SUPPORTED
+#define EVENTS_RINGBUF_SIZE (1 << 24)
+#endif
 
 #ifdef BTF_SUPPORTED
 #define GET_FIELD_ADDR(field) __builtin_preserve_access_index(&field)
@@ -297,7 +307,100 @@ typedef struct buffers
 BPF_PERCPU_ARRAY(bufs, bufs_t, 4);
 BPF_PERCPU_ARRAY(bufs_offset, u32, 4);
 
+#ifdef RINGBUF_SUPPORTED
+BPF_RINGBUF_OUTPUT(sys_events, EVENTS_RINGBUF_SIZE);
+#else
 BPF_PERF_OUTPUT(sys_events);
+#endif
+
+// == Stats == //
+
+// run time histograms of the kretprobes keyed by event id, recorded only when built with STATS=1
+#define STATS_HIST_BUCKETS 32
+
+struct hook_stats
+{
+    u64 count;
+    u64 dropped; // events lost because the perf buffer was full
+    u64 total_ns;
+    // bucket i counts runs that took [2^i, 2^(i+1)) ns
+    u64 hist[STATS_HIST_BUCKETS];
+};
+
+BPF_MAP(kubearmor_hook_stats, BPF_MAP_TYPE_PERCPU_HASH, u32, struct hook_stats, 64);
+BPF_ARRAY(stats_zero, struct hook_stats, 1);
+
+#ifdef KUBEARMOR_STATS
+static __always_inline struct hook_stats *get_hook_stats(u32 id)
+{
+    struct hook_stats *s = bpf_map_lookup_elem(&kubearmor_hook_stats, &id);
+    if (s == NULL)
+    {
+        u32 zero = 0;
+        struct hook_stats *init = bpf_map_lookup_elem(&stats_zero, &zero);
+        if (init == NULL)
+            return NULL;
+        bpf_map_update_elem(&kubearmor_hook_stats, &id, init, BPF_NOEXIST);
+        s = bpf_map_lookup_elem(&kubearmor_hook_stats, &id);
+    }
+    return s;
+}
+
+static __always_inline u32 stats_log2(u64 v)
+{
+    u32 r, shift;
+
+    r = (v > 0xFFFFFFFF) << 5;
+    v >>= r;
+    shift = (v > 0xFFFF) << 4;
+    v >>= shift;
+    r |= shift;
+    shift = (v > 0xFF) << 3;
+    v >>= shift;
+    r |= shift;
+    shift = (v > 0xF) << 2;
+    v >>= shift;
+    r |= shift;
+    shift = (v > 0x3) << 1;
+    v >>= shift;
+    r |= shift;
+    r |= (v >> 1);
+
+    return r;
+}
+
+static __always_inline void stats_record(u32 id, u64 start)
+{
+    u64 delta = bpf_ktime_get_ns() - start;
+
+    struct hook_stats *s = get_hook_stats(id);
+    if (s == NULL)
+        return;
+
+    s->count++;
+    s->total_ns += delta;
+
+    u32 bucket = stats_log2(delta);
+    if (bucket >= STATS_HIST_BUCKETS)
+        bucket = STATS_HIST_BUCKETS - 1;
+    s->hist[bucket]++;
+}
+
+static __always_inline void stats_dropped(u32 id)
+{
+    struct hook_stats *s = get_hook_stats(id);
+    if (s)
+        s->dropped++;
+}
+
+#define STATS_START() u64 stats_start = bpf_ktime_get_ns()
+#define STATS_RECORD(ID) stats_record(ID, stats_start)
+#define STATS_DROPPED(ID) stats_dropped(ID)
+#else
+#define STATS_START()
+#define STATS_RECORD(ID)
+#define STATS_DROPPED(ID)
+#endif
 
 // == Visibility == //
 
@@ -318,42 +421,75 @@ struct outer_key
     u32 mnt_ns;
 };
 
-struct visibility
+// Monitoring state of a container, or of the host for the key (0, 0),
+// written by userspace so that probes decide with a single lookup
+#define NS_VISIBLE_ALL ((1 << _FILE_PROBE) | (1 << _PROCESS_PROBE) | (1 << _NETWORK_PROBE) | (1 << _CAPS_PROBE))
+#define NS_UNTRACKED (1 << 0) // the container is in an untracked namespace
+
+struct ns_state
+{
+    u32 visibility; // 1 << scope for each traced probe scope
+    u32 flags;
+};
+
+struct
 {
-    __uint(type, BPF_MAP_TYPE_HASH_OF_MAPS);
+    __uint(type, BPF_MAP_TYPE_HASH);
     __type(key, struct outer_key);
-    __type(value, u32);
+    __type(value, struct ns_state);
     /*
         https://github.com/kubernetes/community/blob/master/sig-scalability/configs-and-limits/thresholds.md#kubernetes-thresholds
         The link above mentions that a node can have a maximun of 110 pods.
     */
     __uint(max_entries, 65535);
     __uint(pinning, LIBBPF_PIN_BY_NAME);
-};
+} kubearmor_ns_state SEC(".maps");
 
-struct visibility kubearmor_visibility SEC(".maps");
-
-#define DEFAULT_VISIBILITY_KEY 0xc0ffee
-
-// == Config == //
+// Path prefixes whose opens are not traced, keyed by the namespaces of the
+// container or by 0 for the prefixes filtered on the whole node
+#define PATH_FILTER_LEN 64
+#define PATH_FILTER_PREFIXLEN ((2 * sizeof(u32) + PATH_FILTER_LEN) * 8)
 
-enum
+struct path_filter_key
 {
-    _MONITOR_HOST = 0,
-    _MONITOR_CONTAINER = 1,
-    _ENFORCER_BPFLSM = 2,
+    u32 prefixlen;
+    u32 pid_ns;
+    u32 mnt_ns;
+    char path[PATH_FILTER_LEN];
 };
 
-struct kaconfig
+struct
 {
-    __uint(type, BPF_MAP_TYPE_HASH);
-    __type(key, u32);
+    __uint(type, BPF_MAP_TYPE_LPM_TRIE);
+    __type(key, struct path_filter_key);
     __type(value, u32);
-    __uint(max_entries, 16);
+    __uint(max_entries, 1024);
+    __uint(map_flags, BPF_F_NO_PREALLOC);
     __uint(pinning, LIBBPF_PIN_BY_NAME);
+} kubearmor_path_filters SEC(".maps");
+
+// == Config == //
+
+// Updated by userspace at run time, the BPF LSM enforcer starts after the
+// monitor is loaded
+struct monitor_config
+{
+    u32 bpflsm_enforcer;    // failed syscalls are alerted by the enforcer itself
+    u32 default_visibility; // visibility of the containers without a state
+    u32 monitor_host;       // the host is traced
+    u32 monitor_container;  // the containers are traced
 };
 
-struct kaconfig kubearmor_config SEC(".maps");
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0)
+volatile struct monitor_config monitor_config SEC(".data") = {
+    .default_visibility = NS_VISIBLE_ALL,
+    .monitor_host = 1,
+    .monitor_container = 1,
+};
+#else
+// no global data, and no BPF LSM either
+BPF_ARRAY(monitor_config_map, struct monitor_config, 1);
+#endif
 
 // == Kernel Helpers == //
 
@@ -439,138 +575,87 @@ static __always_inline void get_outer_key(struct outer_key *pokey,
     }
 }
 
-static __always_inline u32 get_kubearmor_config(u32 config)
+static __always_inline u32 bpflsm_enforcer()
 {
-    u32 *value = bpf_map_lookup_elem(&kubearmor_config, &config);
-    if (!value)
-    {
-        return 0;
-    }
-
-    return *value;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0)
+    return monitor_config.bpflsm_enforcer;
+#else
+    return 0;
+#endif
 }
 
-// == Pid NS Management == //
-
-static __always_inline u32 add_pid_ns()
+static __always_inline u32 default_visibility()
 {
-    struct task_struct *task = (struct task_struct *)bpf_get_current_task();
-    u32 one = 1;
-    u32 pid_ns = get_task_pid_ns_id(task);
-    if (pid_ns == PROC_PID_INIT_INO && get_kubearmor_config(_MONITOR_HOST))
-    { // host
-        u32 pid = bpf_get_current_pid_tgid() >> 32;
-        if (!bpf_map_lookup_elem(&pid_ns_map, &pid))
-        {
-            // untracked host pid, adding to pid map
-            bpf_map_update_elem(&pid_ns_map, &pid, &one, BPF_ANY);
-        }
-
-        return pid;
-    }
-    else if(get_kubearmor_config(_MONITOR_CONTAINER))
-    { // container
-        if (!bpf_map_lookup_elem(&pid_ns_map, &pid_ns))
-        {
-            // untracked pid ns, adding to pid ns map
-            bpf_map_update_elem(&pid_ns_map, &pid_ns, &one, BPF_ANY);
-        }
-        
-        return pid_ns;
-    }
-
-    return 0;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0)
+    return monitor_config.default_visibility;
+#else
+    u32 zero = 0;
+    struct monitor_config *config = bpf_map_lookup_elem(&monitor_config_map, &zero);
+    if (!config)
+        return NS_VISIBLE_ALL;
+    return config->default_visibility;
+#endif
 }
 
-static __always_inline u32 remove_pid_ns()
+// the namespace of the task is only read if one of the host and the
+// containers is not traced
+static __always_inline u32 monitor_task()
 {
-    struct task_struct *task = (struct task_struct *)bpf_get_current_task();
-
-    u32 pid_ns = get_task_pid_ns_id(task);
-    if (pid_ns == PROC_PID_INIT_INO && get_kubearmor_config(_MONITOR_HOST))
-    { // host
-        u32 pid = bpf_get_current_pid_tgid() >> 32;
-        if (bpf_map_lookup_elem(&pid_ns_map, &pid) != 0)
-        {
-            bpf_map_delete_elem(&pid_ns_map, &pid);
-            return 0;
-        }
-    }
-    else if(get_kubearmor_config(_MONITOR_CONTAINER))
-    { // container
-        if (get_task_ns_pid(task) == 1)
-        {
-            bpf_map_delete_elem(&pid_ns_map, &pid_ns);
-            return 0;
-        }
-    }
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0)
+    u32 host = monitor_config.monitor_host;
+    u32 container = monitor_config.monitor_container;
+#else
+    u32 zero = 0;
+    struct monitor_config *config = bpf_map_lookup_elem(&monitor_config_map, &zero);
+    if (!config)
+        return 1;
+    u32 host = config->monitor_host;
+    u32 container = config->monitor_container;
+#endif
+    if (host && container)
+        return 1;
+    if (!host && !container)
+        return 0;
 
-    return 0;
+    struct task_struct *task = (struct task_struct *)bpf_get_current_task();
+    if (get_task_pid_ns_id(task) == PROC_PID_INIT_INO)
+        return host;
+    return container;
 }
 
-static __always_inline u32 drop_syscall(u32 scope)
+// == Namespace State == //
+
+static __always_inline struct ns_state *get_ns_state()
 {
     struct outer_key okey;
     struct task_struct *task = (struct task_struct *)bpf_get_current_task();
     get_outer_key(&okey, task);
 
-    // We try check global config to check if lookup for container fails do we need to ignore or trace a syscall
-    // In case lookup for global config fails we continue the container check 
-    // and choose to not drop events if either of them are not found
-
-    u32 default_trace = _TRACE_SYSCALL;
-    struct outer_key defaultvizkey;
-    defaultvizkey.pid_ns = DEFAULT_VISIBILITY_KEY;
-    defaultvizkey.mnt_ns = DEFAULT_VISIBILITY_KEY;
-    u32 *d_visibility = bpf_map_lookup_elem(&kubearmor_visibility, &defaultvizkey);
-    if (d_visibility) {
-        u32 *d_on_off_switch = bpf_map_lookup_elem(d_visibility, &scope);
-        if (d_on_off_switch)
-            if (*d_on_off_switch)
-                default_trace = _IGNORE_SYSCALL;
-    }
-
-
-    u32 *ns_visibility = bpf_map_lookup_elem(&kubearmor_visibility, &okey);
-    if (!ns_visibility)
-    {
-        return default_trace;
-    }
+    return bpf_map_lookup_elem(&kubearmor_ns_state, &okey);
+}
 
-    u32 *on_off_switch = bpf_map_lookup_elem(ns_visibility, &scope);
-    if (!on_off_switch)
-    {
-        return default_trace;
-    }
+// no event of a container in an untracked namespace goes to userspace, nor
+// of the host or the containers if their monitoring is off
+static __always_inline u32 skip_syscall(struct ns_state *state)
+{
+    if (state && (state->flags & NS_UNTRACKED))
+        return _IGNORE_SYSCALL;
 
-    if (*on_off_switch)
+    if (!monitor_task())
         return _IGNORE_SYSCALL;
 
     return _TRACE_SYSCALL;
 }
 
-static __always_inline u32 skip_syscall()
+// containers userspace has not seen yet follow the default visibility
+static __always_inline u32 drop_syscall(struct ns_state *state, u32 scope)
 {
-    struct task_struct *task = (struct task_struct *)bpf_get_current_task();
-    u32 pid_ns = get_task_pid_ns_id(task);
+    u32 visibility = state ? state->visibility : default_visibility();
 
-    if (pid_ns == PROC_PID_INIT_INO && get_kubearmor_config(_MONITOR_HOST))
-    { // host
-        u32 pid = bpf_get_current_pid_tgid() >> 32;
-        if (bpf_map_lookup_elem(&pid_ns_map, &pid) != 0)
-        {
-            return !add_pid_ns();
-        }
-    }
-    else if(get_kubearmor_config(_MONITOR_CONTAINER))
-    { // container
-        if (bpf_map_lookup_elem(&pid_ns_map, &pid_ns) == 0)
-        {
-            return !add_pid_ns();
-        }
-    }
+    if (visibility & (1 << scope))
+        return _TRACE_SYSCALL;
 
-    return _TRACE_SYSCALL;
+    return _IGNORE_SYSCALL;
 }
 
 // == Buffer Management == //
@@ -649,71 +734,116 @@ static __always_inline int save_str_to_buffer(bufs_t *bufs_p, void *ptr)
     return 0;
 }
 
+// bpf_loop is available from 5.17, older kernels use the unrolled walker
+// limited to MAX_LOOP_LIMIT components
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 17, 0)
+#define PATH_WALK_LOOP
+// a path of MAX_STRING_SIZE bytes has at most this many components
+#define MAX_PATH_COMPONENTS (MAX_STRING_SIZE / 2)
+#endif
+
+struct prepend_path_ctx
+{
+    struct dentry *dentry;
+    struct vfsmount *vfsmnt;
+    struct mount *mnt;
+    int offset;
+    int buf_type;
+};
+
+// prepends one component of the path, returns 1 once the walk reached the root or the buffer is full
+static __always_inline long prepend_path_step(struct prepend_path_ctx *ctx, bufs_t *string_p)
+{
+    char slash = '/';
+
+    struct dentry *parent;
+    struct dentry *mnt_root;
+    struct mount *m;
+    struct qstr d_name;
+
+    bpf_probe_read(&parent, sizeof(struct dentry *), &ctx->dentry->d_parent);
+    bpf_probe_read(&mnt_root, sizeof(struct dentry *), &ctx->vfsmnt->mnt_root);
+
+    if (ctx->dentry == mnt_root)
+    {
+        bpf_probe_read(&m, sizeof(struct mount *), &ctx->mnt->mnt_parent);
+        if (ctx->mnt != m)
+        {
+            bpf_probe_read(&ctx->dentry, sizeof(struct dentry *), &ctx->mnt->mnt_mountpoint);
+            ctx->mnt = m;
+            ctx->vfsmnt = &m->mnt;
+            return 0;
+        }
+
+        /* Global root */
+        return 1;
+    }
+
+    if (ctx->dentry == parent)
+    {
+        return 1;
+    }
+
+    // get d_name
+    bpf_probe_read(&d_name, sizeof(struct qstr), &ctx->dentry->d_name);
+    int offset = ctx->offset - (d_name.len + 1);
+    if (offset < 0)
+        return 1;
+
+    int sz = bpf_probe_read_str(&(string_p->buf[(offset) & (MAX_STRING_SIZE - 1)]), (d_name.len + 1) & (MAX_STRING_SIZE - 1), d_name.name);
+    if (sz > 1)
+    {
+        bpf_probe_read(&(string_p->buf[(offset + d_name.len) & (MAX_STRING_SIZE - 1)]), 1, &slash);
+        ctx->offset = offset;
+    }
+
+    ctx->dentry = parent;
+    return 0;
+}
+
+#ifdef PATH_WALK_LOOP
+static long prepend_path_cb(u32 index, void *data)
+{
+    struct prepend_path_ctx *ctx = data;
+
+    bufs_t *string_p = get_buffer(ctx->buf_type);
+    if (string_p == NULL)
+        return 1;
+
+    return prepend_path_step(ctx, string_p);
+}
+#endif
+
 static __always_inline bool prepend_path(struct path *path, bufs_t *string_p, int buf_type)
 {
     char slash = '/';
     char null = '\0';
-    int offset = MAX_STRING_SIZE;
 
     if (path == NULL || string_p == NULL)
     {
         return false;
     }
 
-    struct dentry *dentry = path->dentry;
-    struct vfsmount *vfsmnt = path->mnt;
+    struct prepend_path_ctx ctx = {};
 
-    struct mount *mnt = real_mount(vfsmnt);
-
-    struct dentry *parent;
-    struct dentry *mnt_root;
-    struct mount *m;
-    struct qstr d_name;
+    ctx.dentry = path->dentry;
+    ctx.vfsmnt = path->mnt;
+    ctx.mnt = real_mount(ctx.vfsmnt);
+    ctx.offset = MAX_STRING_SIZE;
+    ctx.buf_type = buf_type;
 
+#ifdef PATH_WALK_LOOP
+    bpf_loop(MAX_PATH_COMPONENTS, prepend_path_cb, &ctx, 0);
+#else
 #pragma unroll
     for (int i = 0; i < MAX_LOOP_LIMIT; i++)
     {
-        bpf_probe_read(&parent, sizeof(struct dentry *), &dentry->d_parent);
-        bpf_probe_read(&mnt_root, sizeof(struct dentry *), &vfsmnt->mnt_root);
-
-        if (dentry == mnt_root)
-        {
-            bpf_probe_read(&m, sizeof(struct mount *), &mnt->mnt_parent);
-            if (mnt != m)
-            {
-                bpf_probe_read(&dentry, sizeof(struct dentry *), &mnt->mnt_mountpoint);
-                bpf_probe_read(&mnt, sizeof(struct mount *), &mnt->mnt_parent);
-                vfsmnt = &mnt->mnt;
-                continue;
-            }
-
-            /* Global root */
-            break;
-        }
-
-        if (dentry == parent)
-        {
-            break;
-        }
-
-        // get d_name
-        bpf_probe_read(&d_name, sizeof(struct qstr), &dentry->d_name);
-        offset -= (d_name.len + 1);
-        if (offset < 0)
+        if (prepend_path_step(&ctx, string_p))
             break;
-
-        int sz = bpf_probe_read_str(&(string_p->buf[(offset) & (MAX_STRING_SIZE - 1)]), (d_name.len + 1) & (MAX_STRING_SIZE - 1), d_name.name);
-        if (sz > 1)
-        {
-            bpf_probe_read(&(string_p->buf[(offset + d_name.len) & (MAX_STRING_SIZE - 1)]), 1, &slash);
-        }
-        else
-        {
-            offset += (d_name.len + 1);
-        }
-
-        dentry = parent;
     }
+#endif
+
+    int offset = ctx.offset;
 
     if (offset == MAX_STRING_SIZE)
     {
@@ -926,7 +1056,43 @@ static __always_inline int events_perf_submit(struct pt_regs *ctx)
     void *data = bufs_p->buf;
     int size = *off & (MAX_BUFFER_SIZE - 1);
 
-    return bpf_perf_event_output(ctx, &sys_events, BPF_F_CURRENT_CPU, data, size);
+#ifdef RINGBUF_SUPPORTED
+    int ret = bpf_ringbuf_output(&sys_events, data, size, 0);
+#else
+    int ret = bpf_perf_event_output(ctx, &sys_events, BPF_F_CURRENT_CPU, data, size);
+#endif
+    if (ret < 0)
+        STATS_DROPPED(((sys_context_t *)data)->event_id);
+    return ret;
+}
+
+// Events carrying only the context are written in place into the ring buffer
+// instead of being assembled in the data buffer first
+static __always_inline int events_context_submit(struct pt_regs *ctx, sys_context_t *context)
+{
+#ifdef RINGBUF_SUPPORTED
+    sys_context_t *event = bpf_ringbuf_reserve(&sys_events, sizeof(sys_context_t), 0);
+    if (event == NULL)
+    {
+        STATS_DROPPED(context->event_id);
+        return -1;
+    }
+
+    __builtin_memcpy(event, context, sizeof(sys_context_t));
+    bpf_ringbuf_submit(event, 0);
+
+    return 0;
+#else
+    set_buffer_offset(DATA_BUF_TYPE, sizeof(sys_context_t));
+
+    bufs_t *bufs_p = get_buffer(DATA_BUF_TYPE);
+    if (bufs_p == NULL)
+        return -1;
+
+    save_context_to_buffer(bufs_p, (void *)context);
+
+    return events_perf_submit(ctx);
+#endif
 }
 
 // == Full Path == //
@@ -973,6 +1139,108 @@ static __always_inline int security_path_task_arg(struct pt_regs *ctx)
 
 // == Context Management == //
 
+#if defined(BTF_SUPPORTED) && LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
+#define TASK_CONTEXT_CACHE 1
+
+// cwd and tty name of a task, kept with the pwd and the tty they were read
+// from since threads sharing the fs_struct of the one calling chdir keep their
+// entry
+struct task_context
+{
+    u64 pwd_dentry;
+    u64 pwd_mnt;
+    u64 cwd_gen;
+    u64 tty;
+    char cwd[CWD_LEN];
+    char tty_name[TTY_LEN];
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_TASK_STORAGE);
+    __uint(map_flags, BPF_F_NO_PREALLOC);
+    __type(key, int);
+    __type(value, struct task_context);
+} kubearmor_task_context SEC(".maps");
+
+// The cwd of a task changes without a new pwd when an ancestor directory is
+// renamed, the root is changed or mounts are moved. Each of these moves on to
+// the next generation once it is done, which drops every cached cwd
+BPF_ARRAY(kubearmor_cwd_gen, u64, 1);
+#endif
+
+#if (defined(BTF_SUPPORTED))
+static __always_inline bool read_cwd(struct path *pwd, char *cwd)
+{
+    bufs_t *string_p = get_buffer(CWD_BUF_TYPE);
+    if (string_p == NULL)
+        return false;
+
+    if (!prepend_path(pwd, string_p, CWD_BUF_TYPE))
+        return false;
+
+    u32 *off = get_buffer_offset(CWD_BUF_TYPE);
+    if (off == NULL)
+        return false;
+
+    bpf_probe_read_str(cwd, CWD_LEN, (void *)&string_p->buf[*off]);
+    return true;
+}
+#endif
+
+#ifdef TASK_CONTEXT_CACHE
+// fills the cwd and the tty of the context from the task storage, the dentry
+// walk only happens after the pwd or the cwd generation changed
+static __always_inline bool init_cached_context(struct task_struct *task, sys_context_t *context)
+{
+    u32 zero = 0;
+    u64 *gen = bpf_map_lookup_elem(&kubearmor_cwd_gen, &zero);
+    if (gen == NULL)
+        return false;
+    // read before the walk, a change during it is seen by the next event
+    u64 cwd_gen = *gen;
+
+    struct task_context *cache = bpf_task_storage_get(&kubearmor_task_context, bpf_get_current_task_btf(), 0,
+                                                      BPF_LOCAL_STORAGE_GET_F_CREATE);
+    if (cache == NULL)
+        return false;
+
+    struct signal_struct *signal = READ_KERN(task->signal);
+    struct tty_struct *tty = NULL;
+    if (signal != NULL)
+        tty = READ_KERN(signal->tty);
+
+    if ((u64)tty != cache->tty)
+    {
+        cache->tty_name[0] = '\0';
+        if (tty != NULL)
+            bpf_probe_read_str(cache->tty_name, TTY_LEN, (void *)tty->name);
+        cache->tty = (u64)tty;
+    }
+    __builtin_memcpy(context->tty, cache->tty_name, TTY_LEN);
+
+    struct fs_struct *fs = READ_KERN(task->fs);
+    struct path pwd = READ_KERN(fs->pwd);
+
+    if ((u64)pwd.dentry != cache->pwd_dentry || (u64)pwd.mnt != cache->pwd_mnt || cwd_gen != cache->cwd_gen)
+    {
+        if (!read_cwd(&pwd, cache->cwd))
+        {
+            // resolved again by the next event
+            cache->cwd[0] = '\0';
+            cache->pwd_dentry = 0;
+            return true;
+        }
+        cache->pwd_dentry = (u64)pwd.dentry;
+        cache->pwd_mnt = (u64)pwd.mnt;
+        cache->cwd_gen = cwd_gen;
+    }
+    __builtin_memcpy(context->cwd, cache->cwd, CWD_LEN);
+
+    return true;
+}
+#endif
+
 static __always_inline u32 init_context(sys_context_t *context)
 {
     struct task_struct *task = (struct task_struct *)bpf_get_current_task();
@@ -1004,6 +1272,11 @@ static __always_inline u32 init_context(sys_context_t *context)
 
     bpf_get_current_comm(&context->comm, sizeof(context->comm));
 
+#ifdef TASK_CONTEXT_CACHE
+    if (init_cached_context(task, context))
+        return 0;
+#endif
+
     // check if tty is attached
     struct signal_struct *signal;
     signal = READ_KERN(task->signal);
@@ -1020,28 +1293,39 @@ static __always_inline u32 init_context(sys_context_t *context)
     fs = READ_KERN(task->fs);
     struct path path = READ_KERN(fs->pwd);
 
-    bufs_t *string_p = get_buffer(CWD_BUF_TYPE);
-    if (string_p == NULL)
-        return 0;
-
-    if (!prepend_path(&path, string_p, CWD_BUF_TYPE))
-    {
-        return 0;
-    }
+    read_cwd(&path, context->cwd);
+#endif
+    return 0;
+}
 
-    u32 *off = get_buffer_offset(CWD_BUF_TYPE);
-    if (off == NULL)
-        return 0;
+#ifdef TASK_CONTEXT_CACHE
+// chdir and fchdir replace the pwd through set_fs_pwd, the cached cwd is
+// dropped even if the new pwd is the same dentry, which may have been renamed
+SEC("kprobe/set_fs_pwd")
+int kprobe__set_fs_pwd(struct pt_regs *ctx)
+{
+    bpf_task_storage_delete(&kubearmor_task_context, bpf_get_current_task_btf());
+    return 0;
+}
 
-    bpf_probe_read_str(&context->cwd, CWD_LEN, (void *)&string_p->buf[*off]);
-#endif
+// attached to the return of the functions renaming directories, changing the
+// root and moving mounts
+SEC("kretprobe/cwd_cache_bump")
+int kretprobe__cwd_cache_bump(struct pt_regs *ctx)
+{
+    u32 zero = 0;
+    u64 *gen = bpf_map_lookup_elem(&kubearmor_cwd_gen, &zero);
+    if (gen != NULL)
+        __sync_fetch_and_add(gen, 1);
     return 0;
 }
+#endif
 
 SEC("kprobe/security_path_mknod")
 int kprobe__security_path_mknod(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
     return security_path__dir_path_args(ctx);
 }
@@ -1049,7 +1333,8 @@ int kprobe__security_path_mknod(struct pt_regs *ctx)
 SEC("kprobe/security_path_unlink")
 int kprobe__security_path_unlink(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
     return security_path__dir_path_args(ctx);
 }
@@ -1057,7 +1342,8 @@ int kprobe__security_path_unlink(struct pt_regs *ctx)
 SEC("kprobe/security_path_rmdir")
 int kprobe__security_path_rmdir(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
     return security_path__dir_path_args(ctx);
 }
@@ -1065,7 +1351,8 @@ int kprobe__security_path_rmdir(struct pt_regs *ctx)
 SEC("kprobe/security_ptrace_access_check")
 int kprobe__security_ptrace_access_check(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
     return security_path_task_arg(ctx);
 }
@@ -1073,10 +1360,11 @@ int kprobe__security_ptrace_access_check(struct pt_regs *ctx)
 SEC("kprobe/security_bprm_check")
 int kprobe__security_bprm_check(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
-    if (get_kubearmor_config(_ENFORCER_BPFLSM) && drop_syscall(_PROCESS_PROBE))
+    if (bpflsm_enforcer() && drop_syscall(ns, _PROCESS_PROBE))
     {
         return 0;
     }
@@ -1131,7 +1419,8 @@ int kprobe__security_bprm_check(struct pt_regs *ctx)
 SEC("kprobe/security_file_open")
 int kprobe__security_file_open(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
     struct file *f = (struct file *)PT_REGS_PARM1(ctx);
@@ -1149,12 +1438,13 @@ int kprobe__security_file_open(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_execve")
 int kprobe__execve(struct pt_regs *ctx)
 {
-    if (skip_syscall()) // keeping track of pidns even if we need to drop the syscall so as to facilitate data for other hooks
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
     {
         return 0;
     }
 
-    if (get_kubearmor_config(_ENFORCER_BPFLSM) && drop_syscall(_PROCESS_PROBE))
+    if (bpflsm_enforcer() && drop_syscall(ns, _PROCESS_PROBE))
     {   
         return 0;
     }
@@ -1192,15 +1482,15 @@ int kprobe__execve(struct pt_regs *ctx)
     return 0;
 }
 
-SEC("kretprobe/__x64_sys_execve")
-int kretprobe__execve(struct pt_regs *ctx)
+static __always_inline int trace_ret_execve(struct pt_regs *ctx)
 {
-    if (get_kubearmor_config(_ENFORCER_BPFLSM) && drop_syscall(_PROCESS_PROBE))
+    struct ns_state *ns = get_ns_state();
+    if (bpflsm_enforcer() && drop_syscall(ns, _PROCESS_PROBE))
     {
         return 0;
     }
 
-    if (skip_syscall())
+    if (skip_syscall(ns))
         return 0;
 
     sys_context_t context = {};
@@ -1218,32 +1508,34 @@ int kretprobe__execve(struct pt_regs *ctx)
         return 0;
     }
 
-    if (context.retval >= 0 && drop_syscall(_PROCESS_PROBE))
+    if (context.retval >= 0 && drop_syscall(ns, _PROCESS_PROBE))
     {
         // we need alerts for apparmor enforcer hence only dropping passed logs
         return 0;
     }
 
-    set_buffer_offset(DATA_BUF_TYPE, sizeof(sys_context_t));
-
-    bufs_t *bufs_p = get_buffer(DATA_BUF_TYPE);
-    if (bufs_p == NULL)
-        return 0;
-
-    save_context_to_buffer(bufs_p, (void *)&context);
-
-    events_perf_submit(ctx);
+    events_context_submit(ctx, &context);
 
     return 0;
 }
 
+SEC("kretprobe/__x64_sys_execve")
+int kretprobe__execve(struct pt_regs *ctx)
+{
+    STATS_START();
+    int ret = trace_ret_execve(ctx);
+    STATS_RECORD(_SYS_EXECVE);
+    return ret;
+}
+
 SEC("kprobe/__x64_sys_execveat")
 int kprobe__execveat(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
-    if (get_kubearmor_config(_ENFORCER_BPFLSM) && drop_syscall(_PROCESS_PROBE))
+    if (bpflsm_enforcer() && drop_syscall(ns, _PROCESS_PROBE))
     {
         return 0;
     }
@@ -1296,13 +1588,13 @@ int kprobe__execveat(struct pt_regs *ctx)
     return 0;
 }
 
-SEC("kretprobe/__x64_sys_execveat")
-int kretprobe__execveat(struct pt_regs *ctx)
+static __always_inline int trace_ret_execveat(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
     
-    if (get_kubearmor_config(_ENFORCER_BPFLSM) && drop_syscall(_PROCESS_PROBE))
+    if (bpflsm_enforcer() && drop_syscall(ns, _PROCESS_PROBE))
     {
         return 0;
     }
@@ -1322,36 +1614,38 @@ int kretprobe__execveat(struct pt_regs *ctx)
         return 0;
     }
 
-    if (context.retval >= 0 && drop_syscall(_PROCESS_PROBE))
+    if (context.retval >= 0 && drop_syscall(ns, _PROCESS_PROBE))
     {
         // we need alerts for apparmor enforcer hence only dropping passed logs
         return 0;
     }
 
-    set_buffer_offset(DATA_BUF_TYPE, sizeof(sys_context_t));
-
-    bufs_t *bufs_p = get_buffer(DATA_BUF_TYPE);
-    if (bufs_p == NULL)
-        return 0;
-
-    save_context_to_buffer(bufs_p, (void *)&context);
-
-    events_perf_submit(ctx);
+    events_context_submit(ctx, &context);
 
     return 0;
 }
 
+SEC("kretprobe/__x64_sys_execveat")
+int kretprobe__execveat(struct pt_regs *ctx)
+{
+    STATS_START();
+    int ret = trace_ret_execveat(ctx);
+    STATS_RECORD(_SYS_EXECVEAT);
+    return ret;
+}
+
 SEC("kprobe/do_exit")
 int kprobe__do_exit(struct pt_regs *ctx)
 {
-    if (skip_syscall())
-        return 0;
-
     u64 tgid = bpf_get_current_pid_tgid();
 
     // delete entry for file access which are not successful and are not deleted from file_map since kretprobe/__x64_sys_openat hook is not triggered
     bpf_map_delete_elem(&file_map, &tgid);
 
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
+        return 0;
+
     sys_context_t context = {};
 
     const long code = PT_REGS_PARM1(ctx);
@@ -1362,29 +1656,40 @@ int kprobe__do_exit(struct pt_regs *ctx)
     context.argnum = 0;
     context.retval = code;
 
-    remove_pid_ns();
-
-    if (get_kubearmor_config(_ENFORCER_BPFLSM) && drop_syscall(_PROCESS_PROBE))
+    if (bpflsm_enforcer() && drop_syscall(ns, _PROCESS_PROBE))
     {
         // dropping after map cleanup
         return 0;
     }
 
-    set_buffer_offset(DATA_BUF_TYPE, sizeof(sys_context_t));
+    events_context_submit(ctx, &context);
 
-    bufs_t *bufs_p = get_buffer(DATA_BUF_TYPE);
-    if (bufs_p == NULL)
-        return 0;
+    return 0;
+}
 
-    save_context_to_buffer(bufs_p, (void *)&context);
+// == Syscall Hooks (File) == //
 
-    events_perf_submit(ctx);
+// reads the syscall arguments from the registers passed to the syscall wrapper
+static __always_inline void read_syscall_args(struct pt_regs *regs, args_t *args)
+{
+    bpf_probe_read(&args->args[0], sizeof(args->args[0]), &PT_REGS_PARM1(regs));
+    bpf_probe_read(&args->args[1], sizeof(args->args[1]), &PT_REGS_PARM2(regs));
+    bpf_probe_read(&args->args[2], sizeof(args->args[2]), &PT_REGS_PARM3(regs));
+    bpf_probe_read(&args->args[3], sizeof(args->args[3]), &PT_REGS_PARM4_SYSCALL(regs));
+    bpf_probe_read(&args->args[4], sizeof(args->args[4]), &PT_REGS_PARM5(regs));
+    bpf_probe_read(&args->args[5], sizeof(args->args[5]), &PT_REGS_PARM6(regs));
+}
+
+static __always_inline int store_args(u32 event_id, args_t *args)
+{
+    u32 tgid = bpf_get_current_pid_tgid();
+    u64 id = ((u64)event_id << 32) | tgid;
+
+    bpf_map_update_elem(&args_map, &id, args, BPF_ANY);
 
     return 0;
 }
 
-// == Syscall Hooks (File) == //
-
 static __always_inline int save_args(u32 event_id, struct pt_regs *ctx)
 {
     args_t args = {};
@@ -1397,21 +1702,10 @@ static __always_inline int save_args(u32 event_id, struct pt_regs *ctx)
     args.args[4] = PT_REGS_PARM5(ctx);
     args.args[5] = PT_REGS_PARM6(ctx);
 #else
-    struct pt_regs *ctx2 = (struct pt_regs *)PT_REGS_PARM1(ctx);
-    bpf_probe_read(&args.args[0], sizeof(args.args[0]), &PT_REGS_PARM1(ctx2));
-    bpf_probe_read(&args.args[1], sizeof(args.args[1]), &PT_REGS_PARM2(ctx2));
-    bpf_probe_read(&args.args[2], sizeof(args.args[2]), &PT_REGS_PARM3(ctx2));
-    bpf_probe_read(&args.args[3], sizeof(args.args[3]), &PT_REGS_PARM4_SYSCALL(ctx2));
-    bpf_probe_read(&args.args[4], sizeof(args.args[4]), &PT_REGS_PARM5(ctx2));
-    bpf_probe_read(&args.args[5], sizeof(args.args[5]), &PT_REGS_PARM6(ctx2));
+    read_syscall_args((struct pt_regs *)PT_REGS_PARM1(ctx), &args);
 #endif
 
-    u32 tgid = bpf_get_current_pid_tgid();
-    u64 id = ((u64)event_id << 32) | tgid;
-
-    bpf_map_update_elem(&args_map, &id, &args, BPF_ANY);
-
-    return 0;
+    return store_args(event_id, &args);
 }
 
 static __always_inline int load_args(u32 event_id, args_t *args)
@@ -1451,21 +1745,11 @@ static __always_inline int get_arg_num(u64 types)
     return argnum;
 }
 
-static __always_inline int trace_ret_generic(u32 id, struct pt_regs *ctx, u64 types, u32 scope)
+static __always_inline int trace_syscall_event(struct ns_state *ns, u32 id, struct pt_regs *ctx, args_t *args, s64 retval, u64 types, u32 scope)
 {
-    if (skip_syscall())
-        return 0;
-
     sys_context_t context = {};
-    args_t args = {};
 
-    if (ctx == NULL)
-        return 0;
-
-    if (load_args(id, &args) != 0)
-        return 0;
-
-    if (get_kubearmor_config(_ENFORCER_BPFLSM) && drop_syscall(scope))
+    if (bpflsm_enforcer() && drop_syscall(ns, scope))
     {
         // dropping after load_args so as the args_map cleanup happens
         return 0;
@@ -1475,7 +1759,7 @@ static __always_inline int trace_ret_generic(u32 id, struct pt_regs *ctx, u64 ty
 
     context.event_id = id;
     context.argnum = get_arg_num(types);
-    context.retval = PT_REGS_RC(ctx);
+    context.retval = retval;
 
     // skip if No such file/directory or if there is an EINPROGRESS
     // EINPROGRESS error, happens when the socket is non-blocking and the connection cannot be completed immediately.
@@ -1484,7 +1768,7 @@ static __always_inline int trace_ret_generic(u32 id, struct pt_regs *ctx, u64 ty
         return 0;
     }
 
-    if (context.retval >= 0 && drop_syscall(scope))
+    if (context.retval >= 0 && drop_syscall(ns, scope))
     {
         // we need alerts for apparmor enforcer hence only dropping passed logs
         return 0;
@@ -1508,59 +1792,69 @@ static __always_inline int trace_ret_generic(u32 id, struct pt_regs *ctx, u64 ty
         return 0;
 
     save_context_to_buffer(bufs_p, (void *)&context);
-    save_args_to_buffer(types, &args);
+    save_args_to_buffer(types, args);
     events_perf_submit(ctx);
     return 0;
 }
 
-#define DIR_PROC "/proc/"
-static __always_inline int isProcDir(char *path)
+static __always_inline int trace_ret_event(u32 id, struct pt_regs *ctx, u64 types, u32 scope)
 {
-    char procDir[] = DIR_PROC;
-    int i = 0;
-    while (i < sizeof(DIR_PROC) - 1 && path[i] != '\0' && path[i] == procDir[i])
-    {
-        i++;
-    }
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
+        return 0;
 
-    if (i == sizeof(DIR_PROC) - 1)
-    {
+    args_t args = {};
+
+    if (ctx == NULL)
         return 0;
-    }
 
-    return 1;
+    if (load_args(id, &args) != 0)
+        return 0;
+
+    return trace_syscall_event(ns, id, ctx, &args, PT_REGS_RC(ctx), types, scope);
 }
 
-#define DIR_SYS "/sys/"
-static __always_inline int isSysDir(char *path)
+static __always_inline int trace_ret_generic(u32 id, struct pt_regs *ctx, u64 types, u32 scope)
 {
-    char sysDir[] = DIR_SYS;
-    int i = 0;
-    while (i < sizeof(DIR_SYS) - 1 && path[i] != '\0' && path[i] == sysDir[i])
-    {
-        i++;
-    }
+    STATS_START();
+    int ret = trace_ret_event(id, ctx, types, scope);
+    STATS_RECORD(id);
+    return ret;
+}
 
-    if (i == sizeof(DIR_SYS) - 1)
-    {
+// opens under the path prefixes filtered for the container or the node are
+// not traced
+static __always_inline int skip_open_path(const char __user *pathname)
+{
+    struct path_filter_key key = {};
+
+    if (bpf_probe_read_str(key.path, PATH_FILTER_LEN, pathname) <= 0)
         return 0;
-    }
 
-    return 1;
+    struct task_struct *task = (struct task_struct *)bpf_get_current_task();
+
+    key.prefixlen = PATH_FILTER_PREFIXLEN;
+    key.pid_ns = get_task_pid_ns_id(task);
+    key.mnt_ns = get_task_mnt_ns_id(task);
+    if (bpf_map_lookup_elem(&kubearmor_path_filters, &key))
+        return 1;
+
+    key.pid_ns = 0;
+    key.mnt_ns = 0;
+    return bpf_map_lookup_elem(&kubearmor_path_filters, &key) != NULL;
 }
 
 SEC("kprobe/__x64_sys_open")
 int kprobe__open(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
     struct pt_regs *ctx2 = (struct pt_regs *)PT_REGS_PARM1(ctx);
     const char __user *pathname = (void *)READ_KERN(PT_REGS_PARM1(ctx2));
-    char path[8];
-    bpf_probe_read(path, 8, pathname);
 
-    if (isProcDir(path) == 0 || isSysDir(path) == 0)
+    if (skip_open_path(pathname))
     {
         return 0;
     }
@@ -1577,15 +1871,14 @@ int kretprobe__open(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_openat")
 int kprobe__openat(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
     struct pt_regs *ctx2 = (struct pt_regs *)PT_REGS_PARM1(ctx);
     const char __user *pathname = (void *)READ_KERN(PT_REGS_PARM2(ctx2));
-    char path[8];
-    bpf_probe_read(path, 8, pathname);
 
-    if (isProcDir(path) == 0 || isSysDir(path) == 0)
+    if (skip_open_path(pathname))
     {
         return 0;
     }
@@ -1602,7 +1895,8 @@ int kretprobe__openat(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_unlink")
 int kprobe__unlink(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
     return save_args(_SYS_UNLINK, ctx);
@@ -1617,7 +1911,8 @@ int kretprobe__unlink(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_unlinkat")
 int kprobe__unlinkat(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
     return save_args(_SYS_UNLINKAT, ctx);
@@ -1632,7 +1927,8 @@ int kretprobe__unlinkat(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_rmdir")
 int kprobe__rmdir(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
     return save_args(_SYS_RMDIR, ctx);
@@ -1647,7 +1943,8 @@ int kretprobe__rmdir(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_close")
 int kprobe__close(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
     return save_args(_SYS_CLOSE, ctx);
@@ -1662,7 +1959,8 @@ int kretprobe__close(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_chown")
 int kprobe__chown(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
     return save_args(_SYS_CHOWN, ctx);
 }
@@ -1676,7 +1974,8 @@ int kretprobe__chown(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_fchownat")
 int kprobe__fchownat(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
     return save_args(_SYS_FCHOWNAT, ctx);
 }
@@ -1690,7 +1989,8 @@ int kretprobe__fchownat(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_setuid")
 int kprobe__setuid(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
     return save_args(_SYS_SETUID, ctx);
 }
@@ -1704,7 +2004,8 @@ int kretprobe__setuid(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_setgid")
 int kprobe__setgid(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
     return save_args(_SYS_SETGID, ctx);
 }
@@ -1718,7 +2019,8 @@ int kretprobe__setgid(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_ptrace")
 int kprobe__ptrace(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
     return save_args(_SYS_PTRACE, ctx);
 }
@@ -1732,7 +2034,8 @@ int kretprobe__ptrace(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_mount")
 int kprobe__mount(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
     return save_args(_SYS_MOUNT, ctx);
 }
@@ -1746,7 +2049,8 @@ int kretprobe__mount(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_umount")
 int kprobe__umount(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
     return save_args(_SYS_UMOUNT, ctx);
 }
@@ -1757,6 +2061,165 @@ int kretprobe__umount(struct pt_regs *ctx)
     return trace_ret_generic(_SYS_UMOUNT, ctx, ARG_TYPE0(STR_T) | ARG_TYPE1(UMOUNT_FLAG_T), _CAPS_PROBE);
 }
 
+// == Syscall Hooks (fexit) == //
+
+#if defined(BTF_SUPPORTED) && LINUX_VERSION_CODE >= KERNEL_VERSION(5, 5, 0)
+
+// fexit programs see the arguments and the return value of a syscall at once
+// and do not pass the arguments through args_map. The system monitor attaches
+// them instead of the kprobe pairs if the kernel supports them, the attach
+// target is set to the syscall wrapper of the architecture at load time
+
+static __always_inline int trace_fexit_event(u32 id, void *ctx, struct pt_regs *regs, long ret, u64 types, u32 scope, int path_arg)
+{
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
+        return 0;
+
+    args_t args = {};
+    read_syscall_args(regs, &args);
+
+    if (path_arg >= 0 && skip_open_path((const char __user *)args.args[path_arg]))
+        return 0;
+
+    return trace_syscall_event(ns, id, ctx, &args, ret, types, scope);
+}
+
+#define FEXIT_SYSCALL(name, id, types, scope, path_arg)                                \
+    SEC("fexit/__x64_sys_" #name)                                                      \
+    int BPF_PROG(fexit__##name, struct pt_regs *regs, long ret)                        \
+    {                                                                                  \
+        STATS_START();                                                                 \
+        int r = trace_fexit_event(id, ctx, regs, ret, types, scope, path_arg);         \
+        STATS_RECORD(id);                                                              \
+        return r;                                                                      \
+    }
+
+FEXIT_SYSCALL(open, _SYS_OPEN, ARG_TYPE0(FILE_TYPE_T) | ARG_TYPE1(OPEN_FLAGS_T), _FILE_PROBE, 0)
+FEXIT_SYSCALL(openat, _SYS_OPENAT, ARG_TYPE0(INT_T) | ARG_TYPE1(FILE_TYPE_T) | ARG_TYPE2(OPEN_FLAGS_T), _FILE_PROBE, 1)
+FEXIT_SYSCALL(unlink, _SYS_UNLINK, ARG_TYPE0(INT_T) | ARG_TYPE1(FILE_TYPE_T), _FILE_PROBE, -1)
+FEXIT_SYSCALL(unlinkat, _SYS_UNLINKAT, ARG_TYPE0(INT_T) | ARG_TYPE1(FILE_TYPE_T) | ARG_TYPE2(UNLINKAT_FLAG_T), _FILE_PROBE, -1)
+FEXIT_SYSCALL(rmdir, _SYS_RMDIR, ARG_TYPE1(FILE_TYPE_T), _FILE_PROBE, -1)
+FEXIT_SYSCALL(chown, _SYS_CHOWN, ARG_TYPE0(FILE_TYPE_T) | ARG_TYPE1(INT_T) | ARG_TYPE2(INT_T), _FILE_PROBE, -1)
+FEXIT_SYSCALL(fchownat, _SYS_FCHOWNAT, ARG_TYPE0(INT_T) | ARG_TYPE1(FILE_TYPE_T) | ARG_TYPE2(INT_T) | ARG_TYPE3(INT_T) | ARG_TYPE4(INT_T), _FILE_PROBE, -1)
+FEXIT_SYSCALL(setuid, _SYS_SETUID, ARG_TYPE0(INT_T), _CAPS_PROBE, -1)
+FEXIT_SYSCALL(setgid, _SYS_SETGID, ARG_TYPE0(INT_T), _CAPS_PROBE, -1)
+FEXIT_SYSCALL(ptrace, _SYS_PTRACE, ARG_TYPE0(PTRACE_REQ_T) | ARG_TYPE1(INT_T) | ARG_TYPE2(FILE_TYPE_T), _CAPS_PROBE, -1)
+FEXIT_SYSCALL(mount, _SYS_MOUNT, ARG_TYPE0(STR_T) | ARG_TYPE1(STR_T) | ARG_TYPE2(STR_T) | ARG_TYPE3(MOUNT_FLAG_T) | ARG_TYPE4(STR_T), _CAPS_PROBE, -1)
+FEXIT_SYSCALL(umount, _SYS_UMOUNT, ARG_TYPE0(STR_T) | ARG_TYPE1(UMOUNT_FLAG_T), _CAPS_PROBE, -1)
+FEXIT_SYSCALL(socket, _SYS_SOCKET, ARG_TYPE0(SOCK_DOM_T) | ARG_TYPE1(SOCK_TYPE_T) | ARG_TYPE2(INT_T), _NETWORK_PROBE, -1)
+FEXIT_SYSCALL(connect, _SYS_CONNECT, ARG_TYPE0(INT_T) | ARG_TYPE1(SOCKADDR_T), _NETWORK_PROBE, -1)
+FEXIT_SYSCALL(accept, _SYS_ACCEPT, ARG_TYPE0(INT_T) | ARG_TYPE1(SOCKADDR_T), _NETWORK_PROBE, -1)
+FEXIT_SYSCALL(bind, _SYS_BIND, ARG_TYPE0(INT_T) | ARG_TYPE1(SOCKADDR_T), _NETWORK_PROBE, -1)
+FEXIT_SYSCALL(listen, _SYS_LISTEN, ARG_TYPE0(INT_T) | ARG_TYPE1(INT_T), _NETWORK_PROBE, -1)
+
+#endif
+
+// == Syscall Dispatcher == //
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 17, 0)
+
+// The dispatcher traces the syscalls set in the syscall table from the
+// sys_enter and sys_exit raw tracepoints. The system monitor fills the table
+// and attaches it instead of the probe pairs if configured to
+
+#define SYSCALL_TABLE_SIZE 512
+
+struct syscall_info
+{
+    u64 types; // ARG_TYPE encoding of the arguments
+    u32 event_id;
+    u32 scope; // visibility scope of the syscall
+    u8 traced;
+    u8 path_arg; // 1-based index of the path checked by skip_open_path, 0 for none
+    u8 pad[6];
+};
+
+BPF_ARRAY(syscall_table, struct syscall_info, SYSCALL_TABLE_SIZE);
+
+#if defined(bpf_target_x86)
+#define SYSCALL_NR(regs) READ_KERN((regs)->orig_ax)
+#ifndef TS_COMPAT
+#define TS_COMPAT 0x0002
+#endif
+#elif defined(bpf_target_arm64)
+#define SYSCALL_NR(regs) READ_KERN((regs)->syscallno)
+#ifndef _TIF_32BIT
+#define _TIF_32BIT (1 << 22)
+#endif
+#endif
+
+// 32-bit syscalls have their own numbers, the syscall table only holds the
+// native ones. Like the probes on the native syscall functions, the
+// dispatcher does not trace them
+static __always_inline bool is_compat_syscall(void)
+{
+    struct task_struct *task = (struct task_struct *)bpf_get_current_task();
+#if defined(bpf_target_x86)
+    return READ_KERN(task->thread_info.status) & TS_COMPAT;
+#elif defined(bpf_target_arm64)
+    return READ_KERN(task->thread_info.flags) & _TIF_32BIT;
+#else
+    return false;
+#endif
+}
+
+SEC("raw_tracepoint/sys_enter")
+int sys_enter_dispatch(struct bpf_raw_tracepoint_args *ctx)
+{
+    u32 nr = ctx->args[1];
+
+    struct syscall_info *info = bpf_map_lookup_elem(&syscall_table, &nr);
+    if (info == NULL || !info->traced || is_compat_syscall())
+        return 0;
+
+    // namespaces are only filtered here, sys_exit only sees the syscalls
+    // whose arguments were stored
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
+        return 0;
+
+    args_t args = {};
+    read_syscall_args((struct pt_regs *)ctx->args[0], &args);
+
+    unsigned long path = 0;
+#pragma unroll
+    for (int i = 0; i < MAX_ARGS; i++)
+    {
+        if (info->path_arg == i + 1)
+            path = args.args[i];
+    }
+    if (path && skip_open_path((const char __user *)path))
+        return 0;
+
+    return store_args(info->event_id, &args);
+}
+
+SEC("raw_tracepoint/sys_exit")
+int sys_exit_dispatch(struct bpf_raw_tracepoint_args *ctx)
+{
+    struct pt_regs *regs = (struct pt_regs *)ctx->args[0];
+    u32 nr = SYSCALL_NR(regs);
+
+    struct syscall_info *info = bpf_map_lookup_elem(&syscall_table, &nr);
+    if (info == NULL || !info->traced || is_compat_syscall())
+        return 0;
+
+    u32 id = info->event_id;
+    args_t args = {};
+
+    if (load_args(id, &args) != 0)
+        return 0;
+
+    STATS_START();
+    struct ns_state *ns = get_ns_state();
+    int ret = trace_syscall_event(ns, id, (struct pt_regs *)ctx, &args, ctx->args[1], info->types, info->scope);
+    STATS_RECORD(id);
+    return ret;
+}
+
+#endif
+
 struct tracepoint_syscalls_sys_exit_t
 {
     unsigned short common_type;
@@ -1771,7 +2234,8 @@ struct tracepoint_syscalls_sys_exit_t
 SEC("tracepoint/syscalls/sys_exit_openat")
 int sys_exit_openat(struct tracepoint_syscalls_sys_exit_t *args)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
     u32 id = _SYS_OPENAT;
@@ -1786,7 +2250,7 @@ int sys_exit_openat(struct tracepoint_syscalls_sys_exit_t *args)
     if (load_args(id, &orig_args) != 0)
         return 0;
 
-    if (get_kubearmor_config(_ENFORCER_BPFLSM) && drop_syscall(_FILE_PROBE))
+    if (bpflsm_enforcer() && drop_syscall(ns, _FILE_PROBE))
     {
         // dropping after load_args so as the args_map cleanup happens
         return 0;
@@ -1805,7 +2269,7 @@ int sys_exit_openat(struct tracepoint_syscalls_sys_exit_t *args)
         return 0;
     }
 
-    if (context.retval >= 0 && drop_syscall(_FILE_PROBE))
+    if (context.retval >= 0 && drop_syscall(ns, _FILE_PROBE))
     {
         return 0;
     }
@@ -1829,7 +2293,8 @@ int sys_exit_openat(struct tracepoint_syscalls_sys_exit_t *args)
 SEC("kprobe/__x64_sys_socket")
 int kprobe__socket(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
     return save_args(_SYS_SOCKET, ctx);
@@ -1844,7 +2309,8 @@ int kretprobe__socket(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_connect")
 int kprobe__connect(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
     return save_args(_SYS_CONNECT, ctx);
@@ -1859,7 +2325,8 @@ int kretprobe__connect(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_accept")
 int kprobe__accept(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
     return save_args(_SYS_ACCEPT, ctx);
@@ -1874,7 +2341,8 @@ int kretprobe__accept(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_bind")
 int kprobe__bind(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
     return save_args(_SYS_BIND, ctx);
@@ -1889,7 +2357,8 @@ int kretprobe__bind(struct pt_regs *ctx)
 SEC("kprobe/__x64_sys_listen")
 int kprobe__listen(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
     return save_args(_SYS_LISTEN, ctx);
@@ -1931,10 +2400,11 @@ static __always_inline int get_connection_info(struct sock_common *conn, struct
 SEC("kprobe/__x64_sys_tcp_connect")
 int kprobe__tcp_connect(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
-    if (get_kubearmor_config(_ENFORCER_BPFLSM) && drop_syscall(_NETWORK_PROBE))
+    if (bpflsm_enforcer() && drop_syscall(ns, _NETWORK_PROBE))
     {
         return 0;
     }
@@ -1952,7 +2422,7 @@ int kprobe__tcp_connect(struct pt_regs *ctx)
     context.argnum = get_arg_num(types);
     context.retval = PT_REGS_RC(ctx);
 
-    if (context.retval >= 0 && drop_syscall(_NETWORK_PROBE))
+    if (context.retval >= 0 && drop_syscall(ns, _NETWORK_PROBE))
     {
         return 0;
     }
@@ -1977,10 +2447,11 @@ int kprobe__tcp_connect(struct pt_regs *ctx)
 SEC("kretprobe/__x64_sys_inet_csk_accept")
 int kretprobe__inet_csk_accept(struct pt_regs *ctx)
 {
-    if (skip_syscall())
+    struct ns_state *ns = get_ns_state();
+    if (skip_syscall(ns))
         return 0;
 
-    if (get_kubearmor_config(_ENFORCER_BPFLSM) && drop_syscall(_NETWORK_PROBE))
+    if (bpflsm_enforcer() && drop_syscall(ns, _NETWORK_PROBE))
     {
         return 0;
     }
@@ -2030,7 +2501,7 @@ int kretprobe__inet_csk_accept(struct pt_regs *ctx)
     context.argnum = get_arg_num(types);
     context.retval = PT_REGS_PARM3(ctx);
 
-    if (context.retval >= 0 && drop_syscall(_NETWORK_PROBE))
+    if (context.retval >= 0 && drop_syscall(ns, _NETWORK_PROBE))
     {
         return 0;
     }
@@ -55,6 +55,15 @@ type KubearmorConfig struct {
 	InitTimeout        string   // Timeout for main thread init stages
 
 	StateAgent bool // enable KubeArmor state agent
+
+	BPFCompactKeys      bool   // Use hashed compact keys for BPF LSM rule maps
+	BPFAlertDedupWindow string // Window in which repeated BPF LSM alerts are folded into one
+	BPFMetricsAddr      string // Address serving the run time statistics of the BPF programs
+	BPFAtomicRuleSwap   bool   // Apply BPF LSM policy updates by swapping in freshly filled rule maps
+	BPFMapBatchSize     int    // Number of entries written or deleted per batch operation on BPF LSM rule maps
+	BPFMaxContainers    int    // Number of containers the BPF LSM enforcer holds rules for, 0 derives it from the pod capacity
+	BPFSyscallDispatch  bool   // Trace syscalls with one sys_enter/sys_exit dispatcher instead of a probe pair per syscall
+	PathFilters         string // Comma separated path prefixes whose opens are not traced on the node
 }
 
 // GlobalCfg Global configuration for Kubearmor
@@ -96,6 +105,14 @@ const (
 	ConfigDefaultPostureLogs             string = "defaultPostureLogs"
 	ConfigInitTimeout                    string = "initTimeout"
 	ConfigStateAgent                     string = "enableKubeArmorStateAgent"
+	ConfigBPFCompactKeys                 string = "bpfCompactKeys"
+	ConfigBPFAlertDedupWindow            string = "bpfAlertDedupWindow"
+	ConfigBPFMetricsAddr                 string = "bpfMetricsAddr"
+	ConfigBPFAtomicRuleSwap              string = "bpfAtomicRuleSwap"
+	ConfigBPFMapBatchSize                string = "bpfMapBatchSize"
+	ConfigBPFMaxContainers               string = "bpfMaxContainers"
+	ConfigBPFSyscallDispatch             string = "bpfSyscallDispatch"
+	ConfigPathFilters                    string = "pathFilters"
 )
 
 func readCmdLineParams() {
@@ -144,6 +161,22 @@ func readCmdLineParams() {
 
 	stateAgent := flag.Bool(ConfigStateAgent, false, "enabling KubeArmor State Agent client")
 
+	bpfCompactKeys := flag.Bool(ConfigBPFCompactKeys, false, "use hashed compact keys for BPF LSM rule maps")
+
+	bpfAlertDedupWindow := flag.String(ConfigBPFAlertDedupWindow, "0s", "window in which repeated BPF LSM alerts are folded into one, 0s disables it")
+
+	bpfMetricsAddr := flag.String(ConfigBPFMetricsAddr, "", "address to serve the run time statistics of the BPF programs on /metrics, empty disables it")
+
+	bpfAtomicRuleSwap := flag.Bool(ConfigBPFAtomicRuleSwap, false, "apply BPF LSM policy updates by swapping in freshly filled rule maps instead of updating the live ones")
+
+	bpfMapBatchSize := flag.Int(ConfigBPFMapBatchSize, 1024, "number of entries written or deleted per batch operation on BPF LSM rule maps, 0 updates entries one by one")
+
+	bpfMaxContainers := flag.Int(ConfigBPFMaxContainers, 0, "number of containers the BPF LSM enforcer can hold rules for, 0 derives it from the pod capacity of the node")
+
+	bpfSyscallDispatch := flag.Bool(ConfigBPFSyscallDispatch, false, "trace syscalls with one sys_enter/sys_exit raw tracepoint dispatcher instead of a probe pair per syscall")
+
+	pathFilters := flag.String(ConfigPathFilters, "/proc/,/sys/", "comma separated path prefixes whose opens are not traced on the node, namespaces add their own with the kubearmor-path-filters annotation")
+
 	flags := []string{}
 	flag.VisitAll(func(f *flag.Flag) {
 		kv := fmt.Sprintf("%s:%v", f.Name, f.Value)
@@ -197,6 +230,22 @@ func readCmdLineParams() {
 	viper.SetDefault(ConfigInitTimeout, *initTimeout)
 
 	viper.SetDefault(ConfigStateAgent, *stateAgent)
+
+	viper.SetDefault(ConfigBPFCompactKeys, *bpfCompactKeys)
+
+	viper.SetDefault(ConfigBPFAlertDedupWindow, *bpfAlertDedupWindow)
+
+	viper.SetDefault(ConfigBPFMetricsAddr, *bpfMetricsAddr)
+
+	viper.SetDefault(ConfigBPFAtomicRuleSwap, *bpfAtomicRuleSwap)
+
+	viper.SetDefault(ConfigBPFMapBatchSize, *bpfMapBatchSize)
+
+	viper.SetDefault(ConfigBPFMaxContainers, *bpfMaxContainers)
+
+	viper.SetDefault(ConfigBPFSyscallDispatch, *bpfSyscallDispatch)
+
+	viper.SetDefault(ConfigPathFilters, *pathFilters)
 }
 
 // LoadConfig Load configuration
@@ -292,6 +341,22 @@ func LoadConfig() error {
 
 	GlobalCfg.StateAgent = viper.GetBool(ConfigStateAgent)
 
+	GlobalCfg.BPFCompactKeys = viper.GetBool(ConfigBPFCompactKeys)
+
+	GlobalCfg.BPFAlertDedupWindow = viper.GetString(ConfigBPFAlertDedupWindow)
+
+	GlobalCfg.BPFMetricsAddr = viper.GetString(ConfigBPFMetricsAddr)
+
+	GlobalCfg.BPFAtomicRuleSwap = viper.GetBool(ConfigBPFAtomicRuleSwap)
+
+	GlobalCfg.BPFMapBatchSize = viper.GetInt(ConfigBPFMapBatchSize)
+
+	GlobalCfg.BPFMaxContainers = viper.GetInt(ConfigBPFMaxContainers)
+
+	GlobalCfg.BPFSyscallDispatch = viper.GetBool(ConfigBPFSyscallDispatch)
+
+	GlobalCfg.PathFilters = viper.GetString(ConfigPathFilters)
+
 	kg.Printf("Final Configuration [%+v]", GlobalCfg)
 
 	return nil
@@ -557,6 +557,11 @@ func KubeArmor() {
 				dm.Logger.Print("Started to protect a host and containers")
 			}
 		}
+
+		if cfg.GlobalCfg.BPFMetricsAddr != "" {
+			go dm.ServeBPFMetrics()
+			dm.Logger.Printf("Started to serve BPF metrics on %s", cfg.GlobalCfg.BPFMetricsAddr)
+		}
 	}
 
 	enableContainerPolicy := true
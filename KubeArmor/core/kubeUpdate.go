@@ -122,6 +122,10 @@ func (dm *KubeArmorDaemon) checkAndUpdateNode(item *corev1.Node) {
 	node.KernelVersion = item.Status.NodeInfo.KernelVersion
 	node.KubeletVersion = item.Status.NodeInfo.KubeletVersion
 
+	if pods, ok := item.Status.Capacity[corev1.ResourcePods]; ok {
+		node.PodCapacity = int(pods.Value())
+	}
+
 	// container runtime
 	node.ContainerRuntimeVersion = item.Status.NodeInfo.ContainerRuntimeVersion
 
@@ -1289,6 +1293,42 @@ func (dm *KubeArmorDaemon) CreateSecurityPolicy(policy ksp.KubeArmorPolicy) (sec
 		}
 	}
 
+	if len(secPolicy.Spec.Network.MatchAddresses) > 0 {
+		for idx, addr := range secPolicy.Spec.Network.MatchAddresses {
+			if addr.Severity == 0 {
+				if secPolicy.Spec.Network.Severity != 0 {
+					secPolicy.Spec.Network.MatchAddresses[idx].Severity = secPolicy.Spec.Network.Severity
+				} else {
+					secPolicy.Spec.Network.MatchAddresses[idx].Severity = secPolicy.Spec.Severity
+				}
+			}
+
+			if len(addr.Tags) == 0 {
+				if len(secPolicy.Spec.Network.Tags) > 0 {
+					secPolicy.Spec.Network.MatchAddresses[idx].Tags = secPolicy.Spec.Network.Tags
+				} else {
+					secPolicy.Spec.Network.MatchAddresses[idx].Tags = secPolicy.Spec.Tags
+				}
+			}
+
+			if len(addr.Message) == 0 {
+				if len(secPolicy.Spec.Network.Message) > 0 {
+					secPolicy.Spec.Network.MatchAddresses[idx].Message = secPolicy.Spec.Network.Message
+				} else {
+					secPolicy.Spec.Network.MatchAddresses[idx].Message = secPolicy.Spec.Message
+				}
+			}
+
+			if len(addr.Action) == 0 {
+				if len(secPolicy.Spec.Network.Action) > 0 {
+					secPolicy.Spec.Network.MatchAddresses[idx].Action = secPolicy.Spec.Network.Action
+				} else {
+					secPolicy.Spec.Network.MatchAddresses[idx].Action = secPolicy.Spec.Action
+				}
+			}
+		}
+	}
+
 	if len(secPolicy.Spec.Capabilities.MatchCapabilities) > 0 {
 		for idx, cap := range secPolicy.Spec.Capabilities.MatchCapabilities {
 			if cap.Severity == 0 {
@@ -1811,6 +1851,42 @@ func (dm *KubeArmorDaemon) ParseAndUpdateHostSecurityPolicy(event tp.K8sKubeArmo
 		}
 	}
 
+	if len(secPolicy.Spec.Network.MatchAddresses) > 0 {
+		for idx, addr := range secPolicy.Spec.Network.MatchAddresses {
+			if addr.Severity == 0 {
+				if secPolicy.Spec.Network.Severity != 0 {
+					secPolicy.Spec.Network.MatchAddresses[idx].Severity = secPolicy.Spec.Network.Severity
+				} else {
+					secPolicy.Spec.Network.MatchAddresses[idx].Severity = secPolicy.Spec.Severity
+				}
+			}
+
+			if len(addr.Tags) == 0 {
+				if len(secPolicy.Spec.Network.Tags) > 0 {
+					secPolicy.Spec.Network.MatchAddresses[idx].Tags = secPolicy.Spec.Network.Tags
+				} else {
+					secPolicy.Spec.Network.MatchAddresses[idx].Tags = secPolicy.Spec.Tags
+				}
+			}
+
+			if len(addr.Message) == 0 {
+				if len(secPolicy.Spec.Network.Message) > 0 {
+					secPolicy.Spec.Network.MatchAddresses[idx].Message = secPolicy.Spec.Network.Message
+				} else {
+					secPolicy.Spec.Network.MatchAddresses[idx].Message = secPolicy.Spec.Message
+				}
+			}
+
+			if len(addr.Action) == 0 {
+				if len(secPolicy.Spec.Network.Action) > 0 {
+					secPolicy.Spec.Network.MatchAddresses[idx].Action = secPolicy.Spec.Network.Action
+				} else {
+					secPolicy.Spec.Network.MatchAddresses[idx].Action = secPolicy.Spec.Action
+				}
+			}
+		}
+	}
+
 	if len(secPolicy.Spec.Capabilities.MatchCapabilities) > 0 {
 		for idx, cap := range secPolicy.Spec.Capabilities.MatchCapabilities {
 			if cap.Severity == 0 {
@@ -2177,6 +2253,7 @@ func (dm *KubeArmorDaemon) UpdateVisibility(action string, namespace string, vis
 			val.File = visibility.File
 			val.Network = visibility.Network
 			val.Process = visibility.Process
+			val.PathFilters = visibility.PathFilters
 			dm.SystemMonitor.NamespacePidsMap[namespace] = val
 			for _, nskey := range val.NsKeys {
 				dm.SystemMonitor.UpdateNsKeyMap("MODIFIED", nskey, visibility)
@@ -2188,6 +2265,8 @@ func (dm *KubeArmorDaemon) UpdateVisibility(action string, namespace string, vis
 				Process:    visibility.Process,
 				Capability: visibility.Capabilities,
 				Network:    visibility.Network,
+
+				PathFilters: visibility.PathFilters,
 			}
 		}
 		dm.Logger.Printf("Namespace %s visibiliy configured %+v", namespace, visibility)
@@ -2203,6 +2282,16 @@ func (dm *KubeArmorDaemon) UpdateVisibility(action string, namespace string, vis
 
 var visibilityKey string = "kubearmor-visibility"
 
+var pathFiltersKey string = "kubearmor-path-filters"
+
+// namespacePathFilters returns the path prefixes whose opens are not traced in the namespace on top of the node ones
+func namespacePathFilters(ns *corev1.Namespace) []string {
+	if ns.Annotations == nil || ns.Annotations[pathFiltersKey] == "" {
+		return nil
+	}
+	return monitor.SplitPathFilters(ns.Annotations[pathFiltersKey])
+}
+
 func (dm *KubeArmorDaemon) updateVisibilityWithCM(cm *corev1.ConfigMap, action string) {
 
 	dm.SystemMonitor.UpdateVisibility() // update host and global default bpf maps
@@ -2226,6 +2315,7 @@ func (dm *KubeArmorDaemon) updateVisibilityWithCM(cm *corev1.ConfigMap, action s
 			Process:      strings.Contains(cm.Data[cfg.ConfigVisibility], "process"),
 			Network:      strings.Contains(cm.Data[cfg.ConfigVisibility], "network"),
 			Capabilities: strings.Contains(cm.Data[cfg.ConfigVisibility], "capabilities"),
+			PathFilters:  namespacePathFilters(&ns),
 		}
 		dm.UpdateVisibility("MODIFIED", ns.Name, visibility)
 	}
@@ -2284,6 +2374,7 @@ func (dm *KubeArmorDaemon) WatchDefaultPosture() cache.InformerSynced {
 						Capabilities: dm.validateVisibility("capabilities", ns.Annotations[visibilityKey]),
 					}
 				}
+				visibility.PathFilters = namespacePathFilters(ns)
 				dm.UpdateDefaultPosture("ADDED", ns.Name, defaultPosture, annotated)
 				dm.UpdateVisibility("ADDED", ns.Name, visibility)
 			}
@@ -2316,6 +2407,7 @@ func (dm *KubeArmorDaemon) WatchDefaultPosture() cache.InformerSynced {
 						Capabilities: dm.validateVisibility("capabilities", ns.Annotations[visibilityKey]),
 					}
 				}
+				visibility.PathFilters = namespacePathFilters(ns)
 				dm.UpdateDefaultPosture("MODIFIED", ns.Name, defaultPosture, annotated)
 				dm.UpdateVisibility("MODIFIED", ns.Name, visibility)
 
@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Authors of KubeArmor
+
+package core
+
+import (
+	"fmt"
+	"io"
+	"net/http"
+	"sort"
+	"strconv"
+
+	cfg "github.com/kubearmor/KubeArmor/KubeArmor/config"
+	mon "github.com/kubearmor/KubeArmor/KubeArmor/monitor"
+)
+
+// ServeBPFMetrics serves the run time statistics of the enforcer and monitor programs in the Prometheus text format
+func (dm *KubeArmorDaemon) ServeBPFMetrics() {
+	mux := http.NewServeMux()
+	mux.HandleFunc("/metrics", dm.writeBPFMetrics)
+
+	if err := http.ListenAndServe(cfg.GlobalCfg.BPFMetricsAddr, mux); err != nil {
+		dm.Logger.Warnf("Failed to serve BPF metrics: %s", err.Error())
+	}
+}
+
+func (dm *KubeArmorDaemon) writeBPFMetrics(w http.ResponseWriter, _ *http.Request) {
+	w.Header().Set("Content-Type", "text/plain; version=0.0.4")
+
+	monitorStats, err := dm.SystemMonitor.HookStats()
+	if err != nil {
+		dm.Logger.Warnf("Failed to read system monitor stats: %s", err.Error())
+	}
+
+	enforcerStats, counters, err := dm.RuntimeEnforcer.BPFStats()
+	if err != nil {
+		dm.Logger.Warnf("Failed to read BPF LSM enforcer stats: %s", err.Error())
+	}
+
+	fmt.Fprintln(w, "# HELP kubearmor_bpf_hook_duration_seconds Run time of the KubeArmor BPF programs.")
+	fmt.Fprintln(w, "# TYPE kubearmor_bpf_hook_duration_seconds histogram")
+	writeHookHistograms(w, "enforcer", enforcerStats)
+	writeHookHistograms(w, "monitor", monitorStats)
+
+	fmt.Fprintln(w, "# HELP kubearmor_bpf_hook_denied_total Requests denied by the BPF LSM enforcer.")
+	fmt.Fprintln(w, "# TYPE kubearmor_bpf_hook_denied_total counter")
+	writeHookErrors(w, "kubearmor_bpf_hook_denied_total", "enforcer", enforcerStats)
+
+	fmt.Fprintln(w, "# HELP kubearmor_bpf_hook_dropped_total Events lost because the event buffer of the system monitor was full.")
+	fmt.Fprintln(w, "# TYPE kubearmor_bpf_hook_dropped_total counter")
+	writeHookErrors(w, "kubearmor_bpf_hook_dropped_total", "monitor", monitorStats)
+
+	fmt.Fprintln(w, "# HELP kubearmor_bpf_enforcer_events_total Cache and alert counters of the BPF LSM enforcer.")
+	fmt.Fprintln(w, "# TYPE kubearmor_bpf_enforcer_events_total counter")
+	names := make([]string, 0, len(counters))
+	for name := range counters {
+		names = append(names, name)
+	}
+	sort.Strings(names)
+	for _, name := range names {
+		fmt.Fprintf(w, "kubearmor_bpf_enforcer_events_total{event=%q} %d\n", name, counters[name])
+	}
+
+	used, size, err := dm.RuntimeEnforcer.BPFContainerMapUsage()
+	if err != nil {
+		dm.Logger.Warnf("Failed to read BPF LSM enforcer container map usage: %s", err.Error())
+	}
+	if size > 0 {
+		fmt.Fprintln(w, "# HELP kubearmor_bpf_enforcer_containers Containers with rules in the outer maps of the BPF LSM enforcer.")
+		fmt.Fprintln(w, "# TYPE kubearmor_bpf_enforcer_containers gauge")
+		fmt.Fprintf(w, "kubearmor_bpf_enforcer_containers %d\n", used)
+		fmt.Fprintln(w, "# HELP kubearmor_bpf_enforcer_containers_max Containers the outer maps of the BPF LSM enforcer can hold.")
+		fmt.Fprintln(w, "# TYPE kubearmor_bpf_enforcer_containers_max gauge")
+		fmt.Fprintf(w, "kubearmor_bpf_enforcer_containers_max %d\n", size)
+	}
+}
+
+// sortedIDs returns the event ids of stats in ascending order
+func sortedIDs(stats map[int32]mon.HookStats) []int32 {
+	ids := make([]int32, 0, len(stats))
+	for id := range stats {
+		ids = append(ids, id)
+	}
+	sort.Slice(ids, func(i, j int) bool { return ids[i] < ids[j] })
+	return ids
+}
+
+func writeHookHistograms(w io.Writer, component string, stats map[int32]mon.HookStats) {
+	for _, id := range sortedIDs(stats) {
+		s := stats[id]
+		labels := fmt.Sprintf("component=%q,hook=%q", component, mon.GetSyscallName(id))
+
+		// bucket i holds the runs shorter than 2^(i+1) ns, except for the last one which the kernel also fills with
+		// every longer run, so it is only reported through the +Inf bucket
+		var cumulative uint64
+		for i, n := range s.Hist[:len(s.Hist)-1] {
+			cumulative += n
+			le := strconv.FormatFloat(float64(uint64(1)<<(i+1))/1e9, 'g', -1, 64)
+			fmt.Fprintf(w, "kubearmor_bpf_hook_duration_seconds_bucket{%s,le=%q} %d\n", labels, le, cumulative)
+		}
+		fmt.Fprintf(w, "kubearmor_bpf_hook_duration_seconds_bucket{%s,le=\"+Inf\"} %d\n", labels, s.Count)
+		fmt.Fprintf(w, "kubearmor_bpf_hook_duration_seconds_sum{%s} %s\n", labels, strconv.FormatFloat(float64(s.TotalNs)/1e9, 'g', -1, 64))
+		fmt.Fprintf(w, "kubearmor_bpf_hook_duration_seconds_count{%s} %d\n", labels, s.Count)
+	}
+}
+
+func writeHookErrors(w io.Writer, metric, component string, stats map[int32]mon.HookStats) {
+	for _, id := range sortedIDs(stats) {
+		fmt.Fprintf(w, "%s{component=%q,hook=%q} %d\n", metric, component, mon.GetSyscallName(id), stats[id].Errors)
+	}
+}
@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Authors of KubeArmor
+
+package core
+
+import (
+	"bytes"
+	"strings"
+	"testing"
+
+	mon "github.com/kubearmor/KubeArmor/KubeArmor/monitor"
+)
+
+func TestWriteHookHistograms(t *testing.T) {
+	s := mon.HookStats{Count: 7, TotalNs: 3000000000}
+	s.Hist[0] = 1
+	s.Hist[1] = 2
+	s.Hist[mon.StatsHistBuckets-2] = 1
+	// runs of 2^31 ns and longer, clamped into the last bucket by the kernel
+	s.Hist[mon.StatsHistBuckets-1] = 3
+
+	var buf bytes.Buffer
+	writeHookHistograms(&buf, "enforcer", map[int32]mon.HookStats{-1: s})
+	lines := strings.Split(strings.TrimSpace(buf.String()), "\n")
+
+	// one line per finite bucket, +Inf, sum and count
+	if len(lines) != mon.StatsHistBuckets+2 {
+		t.Fatalf("got %d lines, want %d:\n%s", len(lines), mon.StatsHistBuckets+2, buf.String())
+	}
+
+	labels := `{component="enforcer",hook="-1",`
+	for i, want := range map[int]string{
+		0:                        `kubearmor_bpf_hook_duration_seconds_bucket` + labels + `le="2e-09"} 1`,
+		1:                        `kubearmor_bpf_hook_duration_seconds_bucket` + labels + `le="4e-09"} 3`,
+		mon.StatsHistBuckets - 2: `kubearmor_bpf_hook_duration_seconds_bucket` + labels + `le="2.147483648"} 4`,
+		mon.StatsHistBuckets - 1: `kubearmor_bpf_hook_duration_seconds_bucket` + labels + `le="+Inf"} 7`,
+		mon.StatsHistBuckets:     `kubearmor_bpf_hook_duration_seconds_sum{component="enforcer",hook="-1"} 3`,
+		mon.StatsHistBuckets + 1: `kubearmor_bpf_hook_duration_seconds_count{component="enforcer",hook="-1"} 7`,
+	} {
+		if lines[i] != want {
+			t.Errorf("line %d = %q, want %q", i, lines[i], want)
+		}
+	}
+}
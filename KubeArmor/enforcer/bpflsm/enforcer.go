@@ -6,15 +6,24 @@ package bpflsm
 
 import (
 	"bytes"
+	"crypto/rand"
 	"encoding/binary"
+	"encoding/hex"
 	"errors"
+	"fmt"
 	"log"
+	"net"
+	"os"
+	"path/filepath"
+	"strconv"
 	"sync"
+	"time"
 
 	"github.com/cilium/ebpf"
 	"github.com/cilium/ebpf/link"
 	"github.com/cilium/ebpf/ringbuf"
 	"github.com/cilium/ebpf/rlimit"
+	"golang.org/x/sys/unix"
 
 	"github.com/kubearmor/KubeArmor/KubeArmor/common"
 	cfg "github.com/kubearmor/KubeArmor/KubeArmor/config"
@@ -37,6 +46,33 @@ type BPFEnforcer struct {
 	InnerMapSpec    *ebpf.MapSpec
 	BPFContainerMap *ebpf.Map
 
+	// rule maps are keyed by RuleKey instead of InnerKey
+	CompactKeys      bool
+	BPFRuleVerifyMap *ebpf.Map
+	hashSeed         uint64
+
+	InnerDirMapSpec    *ebpf.MapSpec
+	BPFContainerDirMap *ebpf.Map
+
+	InnerNetMapSpec    *ebpf.MapSpec
+	BPFContainerNetMap *ebpf.Map
+
+	// policy updates build new inner maps and swap them into the outer maps
+	AtomicRuleSwap bool
+
+	// entries per batch operation on rule maps, 0 disables batching
+	mapBatchSize int
+
+	// entries of the outer maps, one per container with rules
+	maxContainers uint32
+
+	// repeated alerts inside the window are folded into one
+	alertDedupWindow time.Duration
+
+	// last alert sent per dedup key, reported again with the repeats folded after it once its window expires
+	foldedAlerts     map[alertDedupKey]tp.Log
+	foldedAlertsLock *sync.Mutex
+
 	// events
 	Events        *ringbuf.Reader
 	EventsChannel chan []byte
@@ -45,9 +81,17 @@ type BPFEnforcer struct {
 	ContainerMap     map[string]ContainerKV
 	ContainerMapLock *sync.RWMutex
 
+	// rule classes and postures of the containers
+	ContainerHdrMap *ebpf.Map
+
+	// policy generation shared by all containers, a container whose rules were removed and added again never reuses a generation
+	policyGen uint32
+
 	obj     enforcerObjects
 	objPath enforcer_pathObjects
 
+	features bpfFeatures
+
 	Probes map[string]link.Link
 
 	Monitor *mon.SystemMonitor
@@ -71,19 +115,68 @@ func NewBPFEnforcer(node tp.Node, pinpath string, logger *fd.Feeder, monitor *mo
 	be.Probes = make(map[string]link.Link)
 	be.ContainerMap = make(map[string]ContainerKV)
 	be.ContainerMapLock = new(sync.RWMutex)
+	be.foldedAlerts = make(map[alertDedupKey]tp.Log)
+	be.foldedAlertsLock = new(sync.Mutex)
+
+	be.CompactKeys = cfg.GlobalCfg.BPFCompactKeys
+	be.AtomicRuleSwap = cfg.GlobalCfg.BPFAtomicRuleSwap
+	be.mapBatchSize = max(cfg.GlobalCfg.BPFMapBatchSize, 0)
+	be.maxContainers = maxContainers(cfg.GlobalCfg.BPFMaxContainers, node.PodCapacity)
+	be.Logger.Printf("BPF LSM outer maps sized for %d containers", be.maxContainers)
+
+	if be.alertDedupWindow, err = time.ParseDuration(cfg.GlobalCfg.BPFAlertDedupWindow); err != nil || be.alertDedupWindow < 0 {
+		be.Logger.Warnf("Not a valid BPFAlertDedupWindow duration: %q, disabling alert deduplication", cfg.GlobalCfg.BPFAlertDedupWindow)
+		be.alertDedupWindow = 0
+	}
+
+	var seed [8]byte
+	if _, err := rand.Read(seed[:]); err != nil {
+		be.Logger.Warnf("error generating hash seed: %s", err)
+	}
+	be.hashSeed = binary.LittleEndian.Uint64(seed[:])
+
+	// hashes cached by an earlier run were generated with another seed
+	if err := os.Remove(filepath.Join(pinpath, "kubearmor_exe_cache")); err != nil && !errors.Is(err, os.ErrNotExist) {
+		be.Logger.Warnf("error removing stale kubearmor_exe_cache map: %s", err)
+	}
+
+	keySize := uint32(512)
+	if be.CompactKeys {
+		keySize = uint32(binary.Size(RuleKey{}))
+	}
 
 	be.InnerMapSpec = &ebpf.MapSpec{
 		Type:       ebpf.Hash,
-		KeySize:    512,
+		KeySize:    keySize,
 		ValueSize:  2,
 		MaxEntries: 256,
 	}
 
+	// Directory rules are matched with a longest prefix match on the path
+	be.InnerDirMapSpec = &ebpf.MapSpec{
+		Type:       ebpf.LPMTrie,
+		KeySize:    uint32(binary.Size(DirKey{})),
+		ValueSize:  uint32(binary.Size(DirValue{})),
+		MaxEntries: 256,
+		Flags:      unix.BPF_F_NO_PREALLOC,
+	}
+
+	// Address rules are matched with a longest prefix match on the address
+	be.InnerNetMapSpec = &ebpf.MapSpec{
+		Type:       ebpf.LPMTrie,
+		KeySize:    uint32(binary.Size(NetAddrKey{})),
+		ValueSize:  uint32(binary.Size(NetAddrValue{})),
+		MaxEntries: 256,
+		Flags:      unix.BPF_F_NO_PREALLOC,
+	}
+
+	be.removeStalePins(pinpath)
+
 	be.BPFContainerMap, err = ebpf.NewMapWithOptions(&ebpf.MapSpec{
 		Type:       ebpf.HashOfMaps,
 		KeySize:    8,
 		ValueSize:  4,
-		MaxEntries: 256,
+		MaxEntries: be.maxContainers,
 		Pinning:    ebpf.PinByName,
 		InnerMap:   be.InnerMapSpec,
 		Name:       "kubearmor_containers",
@@ -95,7 +188,42 @@ func NewBPFEnforcer(node tp.Node, pinpath string, logger *fd.Feeder, monitor *mo
 		return be, err
 	}
 
-	if err := loadEnforcerObjects(&be.obj, &ebpf.CollectionOptions{
+	be.BPFContainerDirMap, err = ebpf.NewMapWithOptions(&ebpf.MapSpec{
+		Type:       ebpf.HashOfMaps,
+		KeySize:    8,
+		ValueSize:  4,
+		MaxEntries: be.maxContainers,
+		Pinning:    ebpf.PinByName,
+		InnerMap:   be.InnerDirMapSpec,
+		Name:       "kubearmor_dir_rules",
+	}, ebpf.MapOptions{
+		PinPath: pinpath,
+	})
+	if err != nil {
+		be.Logger.Errf("error creating kubearmor_dir_rules map: %s", err)
+		return be, err
+	}
+
+	be.BPFContainerNetMap, err = ebpf.NewMapWithOptions(&ebpf.MapSpec{
+		Type:       ebpf.HashOfMaps,
+		KeySize:    8,
+		ValueSize:  4,
+		MaxEntries: be.maxContainers,
+		Pinning:    ebpf.PinByName,
+		InnerMap:   be.InnerNetMapSpec,
+		Name:       "kubearmor_net_rules",
+	}, ebpf.MapOptions{
+		PinPath: pinpath,
+	})
+	if err != nil {
+		be.Logger.Errf("error creating kubearmor_net_rules map: %s", err)
+		return be, err
+	}
+
+	be.features = probeFeatures()
+	be.Logger.Printf("BPF LSM optional features: task storage=%t bpf_loop=%t bpf_d_path=%t", be.features.TaskStorage, be.features.BPFLoop, be.features.DPath)
+
+	if err := be.loadObjects(loadEnforcer, &be.obj, &ebpf.CollectionOptions{
 		Maps: ebpf.MapOptions{
 			PinPath: pinpath,
 		},
@@ -104,6 +232,9 @@ func NewBPFEnforcer(node tp.Node, pinpath string, logger *fd.Feeder, monitor *mo
 		return be, err
 	}
 
+	be.BPFRuleVerifyMap = be.obj.KubearmorRuleVerify
+	be.ContainerHdrMap = be.obj.KubearmorContainerHdr
+
 	be.Probes[be.obj.EnforceProc.String()], err = link.AttachLSM(link.LSMOptions{Program: be.obj.EnforceProc})
 	if err != nil {
 		be.Logger.Errf("opening lsm %s: %s", be.obj.EnforceProc.String(), err)
@@ -122,6 +253,12 @@ func NewBPFEnforcer(node tp.Node, pinpath string, logger *fd.Feeder, monitor *mo
 		return be, err
 	}
 
+	be.Probes[be.obj.FreeFileVerdict.String()], err = link.AttachLSM(link.LSMOptions{Program: be.obj.FreeFileVerdict})
+	if err != nil {
+		be.Logger.Errf("opening lsm %s: %s", be.obj.FreeFileVerdict.String(), err)
+		return be, err
+	}
+
 	be.Probes[be.obj.EnforceNetCreate.String()], err = link.AttachLSM(link.LSMOptions{Program: be.obj.EnforceNetCreate})
 	if err != nil {
 		be.Logger.Errf("opening lsm %s: %s", be.obj.EnforceNetCreate.String(), err)
@@ -139,12 +276,26 @@ func NewBPFEnforcer(node tp.Node, pinpath string, logger *fd.Feeder, monitor *mo
 		be.Logger.Errf("opening lsm %s: %s", be.obj.EnforceNetAccept.String(), err)
 		return be, err
 	}
+
+	be.Probes[be.obj.EnforceNetBind.String()], err = link.AttachLSM(link.LSMOptions{Program: be.obj.EnforceNetBind})
+	if err != nil {
+		be.Logger.Errf("opening lsm %s: %s", be.obj.EnforceNetBind.String(), err)
+		return be, err
+	}
 	be.Probes[be.obj.EnforceCap.String()], err = link.AttachLSM(link.LSMOptions{Program: be.obj.EnforceCap})
 	if err != nil {
 		be.Logger.Errf("opening lsm %s: %s", be.obj.EnforceCap.String(), err)
 		return be, err
 	}
 
+	if be.features.TaskStorage {
+		be.Probes[be.obj.InvalidateExeCache.String()], err = link.AttachLSM(link.LSMOptions{Program: be.obj.InvalidateExeCache})
+		if err != nil {
+			be.Logger.Errf("opening lsm %s: %s", be.obj.InvalidateExeCache.String(), err)
+			return be, err
+		}
+	}
+
 	/*
 		Path Hooks
 
@@ -155,7 +306,10 @@ func NewBPFEnforcer(node tp.Node, pinpath string, logger *fd.Feeder, monitor *mo
 		We only warn if we fail to load the following hooks
 	*/
 
-	if err := loadEnforcer_pathObjects(&be.objPath, &ebpf.CollectionOptions{
+	// Resolved paths are only cached when the path hooks can invalidate them on rename
+	pathCache := false
+
+	if err := be.loadObjects(loadEnforcer_path, &be.objPath, &ebpf.CollectionOptions{
 		Maps: ebpf.MapOptions{
 			PinPath: common.GetMapRoot(),
 		},
@@ -216,6 +370,15 @@ func NewBPFEnforcer(node tp.Node, pinpath string, logger *fd.Feeder, monitor *mo
 		be.Probes[be.objPath.EnforceRenameOld.String()], err = link.AttachLSM(link.LSMOptions{Program: be.objPath.EnforceRenameOld})
 		if err != nil {
 			be.Logger.Warnf("opening lsm %s: %s", be.objPath.EnforceRenameOld.String(), err)
+		} else {
+			be.Probes[be.objPath.InvalidateRename.String()], err = link.AttachTracing(link.TracingOptions{Program: be.objPath.InvalidateRename})
+			if err != nil {
+				be.Logger.Warnf("opening fexit %s: %s", be.objPath.InvalidateRename.String(), err)
+			} else if err := be.attachMountInvalidation(); err != nil {
+				be.Logger.Warnf("error invalidating the path cache on mount changes, paths are not cached: %s", err)
+			} else {
+				pathCache = true
+			}
 		}
 
 		be.Probes[be.objPath.EnforceRmdir.String()], err = link.AttachLSM(link.LSMOptions{Program: be.objPath.EnforceRmdir})
@@ -224,6 +387,8 @@ func NewBPFEnforcer(node tp.Node, pinpath string, logger *fd.Feeder, monitor *mo
 		}
 	}
 
+	be.setPathCache(pathCache)
+
 	be.Events, err = ringbuf.NewReader(be.obj.KubearmorEvents)
 	if err != nil {
 		be.Logger.Errf("opening ringbuf reader: %s", err)
@@ -240,7 +405,60 @@ func NewBPFEnforcer(node tp.Node, pinpath string, logger *fd.Feeder, monitor *mo
 	return be, nil
 }
 
-type eventBPF struct {
+// mountChanges are the functions changing the paths below a mountpoint without a rename: mounts and bind mounts,
+// unmounts and mount moves
+var mountChanges = []string{"path_mount", "path_umount", "do_move_mount"}
+
+// attachMountInvalidation moves the path cache to the next generation on the return of the mountChanges as well, an
+// fexit program has a single target so the rename invalidation program is loaded once for each of them
+func (be *BPFEnforcer) attachMountInvalidation() error {
+	spec, err := loadEnforcer_path()
+	if err != nil {
+		return err
+	}
+	if err := spec.RewriteMaps(map[string]*ebpf.Map{"kubearmor_path_gen": be.objPath.KubearmorPathGen}); err != nil {
+		return err
+	}
+
+	for _, fn := range mountChanges {
+		ps := spec.Programs["invalidate_rename"].Copy()
+		ps.AttachTo = fn
+
+		prog, err := ebpf.NewProgram(ps)
+		if err != nil {
+			return fmt.Errorf("loading fexit %s: %w", fn, err)
+		}
+		// the link keeps the program loaded
+		l, err := link.AttachTracing(link.TracingOptions{Program: prog})
+		prog.Close()
+		if err != nil {
+			return fmt.Errorf("opening fexit %s: %w", fn, err)
+		}
+		be.Probes["invalidate_"+fn] = l
+	}
+
+	return nil
+}
+
+// setPathCache moves the resolved path cache to a fresh generation, generation 0 keeps the cache disabled
+func (be *BPFEnforcer) setPathCache(enable bool) {
+	var gen uint64
+
+	if enable {
+		// the map is pinned so entries from an earlier run must not be served
+		if err := be.obj.KubearmorPathGen.Lookup(uint32(0), &gen); err != nil {
+			be.Logger.Warnf("error reading path cache generation: %s", err)
+		}
+		gen++
+	}
+
+	if err := be.obj.KubearmorPathGen.Put(uint32(0), gen); err != nil {
+		be.Logger.Warnf("error updating path cache generation: %s", err)
+	}
+}
+
+// alertHeader is the fixed part of an alert record, the path and the source follow it
+type alertHeader struct {
 	Ts uint64
 
 	PidID uint32
@@ -257,11 +475,58 @@ type eventBPF struct {
 
 	Retval int64
 
-	Comm [80]byte
+	Comm [16]byte
+
+	PathLen   uint16
+	SourceLen uint16
+
+	// alerts of the same kind folded into this one
+	Repeat uint32
+}
+
+type eventBPF struct {
+	alertHeader
 
 	Data InnerKey
 }
 
+// netAddrResource formats the address of a network alert, the BPF programs send the family followed by the port and the address in hex digits
+func netAddrResource(eventID int32, path []byte) string {
+	ip := make(net.IP, net.IPv4len)
+	if path[1] == afInet6 {
+		ip = make(net.IP, net.IPv6len)
+	}
+	if _, err := hex.Decode(ip, path[6:6+2*len(ip)]); err != nil {
+		return ""
+	}
+	port, err := strconv.ParseUint(string(path[2:6]), 16, 16)
+	if err != nil {
+		return ""
+	}
+
+	if eventID == mon.SocketBind {
+		return "localip=" + ip.String() + " port=" + strconv.FormatUint(port, 10)
+	}
+	return "remoteip=" + ip.String() + " port=" + strconv.FormatUint(port, 10)
+}
+
+// decodeEvent decodes a length prefixed alert record
+func decodeEvent(raw []byte, event *eventBPF) error {
+	if err := binary.Read(bytes.NewReader(raw), binary.LittleEndian, &event.alertHeader); err != nil {
+		return err
+	}
+
+	data := raw[binary.Size(event.alertHeader):]
+	if len(data) < int(event.PathLen)+int(event.SourceLen) {
+		return fmt.Errorf("truncated record of %d bytes", len(raw))
+	}
+
+	copy(event.Data.Path[:], data[:event.PathLen])
+	copy(event.Data.Source[:], data[event.PathLen:event.PathLen+event.SourceLen])
+
+	return nil
+}
+
 // TraceEvents traces events generated by bpflsm enforcer
 func (be *BPFEnforcer) TraceEvents() {
 
@@ -289,13 +554,27 @@ func (be *BPFEnforcer) TraceEvents() {
 		}
 	}()
 
+	// folded alerts are flushed at the end of their window even if no alert of the same kind follows
+	var flush <-chan time.Time
+	if be.alertDedupWindow > 0 {
+		ticker := time.NewTicker(be.alertDedupWindow)
+		defer ticker.Stop()
+		flush = ticker.C
+	}
+
 	for {
 
-		dataRaw := <-be.EventsChannel
+		var dataRaw []byte
+		select {
+		case dataRaw = <-be.EventsChannel:
+		case <-flush:
+			be.flushFoldedAlerts(false)
+			continue
+		}
 
 		var event eventBPF
 
-		if err := binary.Read(bytes.NewBuffer(dataRaw), binary.LittleEndian, &event); err != nil {
+		if err := decodeEvent(dataRaw, &event); err != nil {
 			log.Printf("parsing ringbuf event: %s", err)
 			continue
 		}
@@ -329,7 +608,16 @@ func (be *BPFEnforcer) TraceEvents() {
 			log.Resource = string(bytes.Trim(event.Data.Path[:], "\x00"))
 			log.Data = "lsm=" + mon.GetSyscallName(int32(event.EventID))
 
-		case mon.SocketCreate, mon.SocketConnect, mon.SocketAccept:
+		case mon.SocketConnect, mon.SocketBind:
+			if event.Data.Path[0] == ADDRESS {
+				log.Operation = "Network"
+				log.Resource = netAddrResource(event.EventID, event.Data.Path[:])
+				log.Data = "lsm=" + mon.GetSyscallName(int32(event.EventID)) + " " + log.Resource
+				break
+			}
+			fallthrough
+
+		case mon.SocketCreate, mon.SocketAccept:
 			var sockProtocol int32
 			sockProtocol = int32(event.Data.Path[1])
 			log.Operation = "Network"
@@ -369,11 +657,114 @@ func (be *BPFEnforcer) TraceEvents() {
 			log.Result = "Permission denied"
 		}
 		log.Enforcer = "BPFLSM"
+		if be.alertDedupWindow > 0 {
+			be.foldedAlertsLock.Lock()
+			be.foldedAlerts[be.alertDedupKey(event)] = log
+			be.foldedAlertsLock.Unlock()
+		}
+		if event.Repeat > 0 {
+			log.Data = log.Data + " repeat=" + strconv.FormatUint(uint64(event.Repeat), 10)
+		}
 		be.Logger.PushLog(log)
 
 	}
 }
 
+// alertDedupKey Structure mirrors struct alert_dedup_key of the BPF programs
+type alertDedupKey struct {
+	NsKey   NsKey
+	EventID int32
+	Retval  int32
+	Path    uint64
+	Source  uint64
+}
+
+// alertDedupValue Structure mirrors struct alert_dedup_val of the BPF programs
+type alertDedupValue struct {
+	Count uint64
+	First uint64
+	Last  uint64
+}
+
+// alertDedupKey returns the key the BPF programs fold repeats of the alert under
+func (be *BPFEnforcer) alertDedupKey(event eventBPF) alertDedupKey {
+	return alertDedupKey{
+		NsKey:   NsKey{PidNS: event.PidID, MntNS: event.MntID},
+		EventID: event.EventID,
+		Retval:  int32(event.Retval),
+		Path:    be.hashStr(event.Data.Path[:]),
+		Source:  be.hashStr(event.Data.Source[:]),
+	}
+}
+
+// flushFoldedAlerts reports the alerts folded in windows which expired, or in all windows, as a repeat of the last alert
+// sent for their key. Without this the repeats were only reported once another alert of the same kind arrived
+func (be *BPFEnforcer) flushFoldedAlerts(all bool) {
+	var ts unix.Timespec
+	if err := unix.ClockGettime(unix.CLOCK_MONOTONIC, &ts); err != nil {
+		return
+	}
+	now := uint64(ts.Nano())
+	window := uint64(be.alertDedupWindow.Nanoseconds())
+
+	be.foldedAlertsLock.Lock()
+	defer be.foldedAlertsLock.Unlock()
+
+	live := make(map[alertDedupKey]struct{})
+
+	for _, m := range []*ebpf.Map{be.obj.KubearmorAlertDedup, be.objPath.KubearmorAlertDedup} {
+		if m == nil {
+			continue
+		}
+
+		var key alertDedupKey
+		var val alertDedupValue
+		expired := []alertDedupKey{}
+
+		iter := m.Iterate()
+		for iter.Next(&key, &val) {
+			live[key] = struct{}{}
+			if val.Count > 0 && (all || now-val.First >= window) {
+				expired = append(expired, key)
+			}
+		}
+		if err := iter.Err(); err != nil {
+			be.Logger.Warnf("error iterating folded alerts: %s", err)
+		}
+
+		for _, key := range expired {
+			// the programs keep counting until the entry is gone, the next alert starts a new window
+			if err := m.LookupAndDelete(key, &val); errors.Is(err, ebpf.ErrNotSupported) {
+				if err = m.Lookup(key, &val); err == nil {
+					err = m.Delete(key)
+				}
+				if err != nil {
+					continue
+				}
+			} else if err != nil {
+				continue
+			}
+
+			log, ok := be.foldedAlerts[key]
+			delete(be.foldedAlerts, key)
+			if !ok || val.Count == 0 {
+				continue
+			}
+
+			log.Timestamp, log.UpdatedTime = common.GetDateTimeNow()
+			log.Data = log.Data + " repeat=" + strconv.FormatUint(val.Count, 10)
+			be.Logger.PushLog(log)
+		}
+	}
+
+	// alerts whose entries the programs evicted have nothing left to report
+	for key := range be.foldedAlerts {
+		if _, ok := live[key]; !ok {
+			delete(be.foldedAlerts, key)
+		}
+	}
+}
+
 // UpdateSecurityPolicies loops through containers present in the input endpoint and updates rules for each container
 func (be *BPFEnforcer) UpdateSecurityPolicies(endPoint tp.EndPoint) {
 	// skip if BPFEnforcer is not active
@@ -407,6 +798,10 @@ func (be *BPFEnforcer) DestroyBPFEnforcer() error {
 	}
 	var errBPFCleanUp error
 
+	if be.alertDedupWindow > 0 {
+		be.flushFoldedAlerts(true)
+	}
+
 	if err := be.obj.Close(); err != nil {
 		be.Logger.Err(err.Error())
 		errBPFCleanUp = errors.Join(errBPFCleanUp, err)
@@ -436,8 +831,40 @@ func (be *BPFEnforcer) DestroyBPFEnforcer() error {
 		}
 	}
 
+	if be.BPFContainerDirMap != nil {
+		if err := be.BPFContainerDirMap.Unpin(); err != nil {
+			be.Logger.Err(err.Error())
+			errBPFCleanUp = errors.Join(errBPFCleanUp, err)
+		}
+		if err := be.BPFContainerDirMap.Close(); err != nil {
+			be.Logger.Err(err.Error())
+			errBPFCleanUp = errors.Join(errBPFCleanUp, err)
+		}
+	}
+
+	if be.BPFContainerNetMap != nil {
+		if err := be.BPFContainerNetMap.Unpin(); err != nil {
+			be.Logger.Err(err.Error())
+			errBPFCleanUp = errors.Join(errBPFCleanUp, err)
+		}
+		if err := be.BPFContainerNetMap.Close(); err != nil {
+			be.Logger.Err(err.Error())
+			errBPFCleanUp = errors.Join(errBPFCleanUp, err)
+		}
+	}
+
 	be.ContainerMapLock.Unlock()
 
+	for _, m := range []*ebpf.Map{be.obj.KubearmorPathCache, be.obj.KubearmorPathGen, be.obj.KubearmorExeCache, be.obj.KubearmorRuleVerify, be.obj.KubearmorContainerHdr} {
+		if m == nil {
+			continue
+		}
+		if err := m.Unpin(); err != nil {
+			be.Logger.Err(err.Error())
+			errBPFCleanUp = errors.Join(errBPFCleanUp, err)
+		}
+	}
+
 	if be.Events != nil {
 		if err := be.obj.KubearmorEvents.Unpin(); err != nil {
 			be.Logger.Err(err.Error())
@@ -12,6 +12,23 @@ import (
 	"github.com/cilium/ebpf"
 )
 
+type enforcerAlertDedupKey struct {
+	Okey struct {
+		PidNs uint32
+		MntNs uint32
+	}
+	EventId uint32
+	Retval  int32
+	Path    uint64
+	Source  uint64
+}
+
+type enforcerAlertDedupVal struct {
+	Count uint64
+	First uint64
+	Last  uint64
+}
+
 type enforcerBufsK struct {
 	Path   [256]int8
 	Source [256]int8
@@ -19,6 +36,83 @@ type enforcerBufsK struct {
 
 type enforcerBufsT struct{ Buf [32768]int8 }
 
+type enforcerContainerHdr struct {
+	Flags       uint32
+	PolicyGen   uint32
+	Posture     [4]uint8
+	AddrPosture [2]uint8
+	Pad         [2]uint8
+	CapDeny     uint64
+	CapAllow    uint64
+}
+
+type enforcerDirKey struct {
+	Prefixlen uint32
+	Source    uint32
+	Path      [252]int8
+}
+
+type enforcerExeCache struct {
+	Exe  uint64
+	Hash uint64
+	Path [256]int8
+}
+
+type enforcerFileVerdict struct {
+	Source    uint64
+	PathGen   uint64
+	PolicyGen uint32
+	Pad       uint32
+}
+
+type enforcerHookStats struct {
+	Count   uint64
+	Denied  uint64
+	TotalNs uint64
+	Hist    [32]uint64
+}
+
+type enforcerPathCacheKey struct {
+	Dentry uint64
+	Mnt    uint64
+}
+
+type enforcerPathCacheVal struct {
+	Gen        uint64
+	Parent     uint64
+	HashLen    uint64
+	Mountpoint uint64
+	Path       [256]int8
+}
+
+type enforcerVerdictKey struct {
+	Okey struct {
+		PidNs uint32
+		MntNs uint32
+	}
+	Dentry uint64
+	Mnt    uint64
+	Source uint64
+	Id     uint32
+	Pad    uint32
+}
+
+type enforcerVerdictVal struct {
+	PathGen   uint64
+	Parent    uint64
+	HashLen   uint64
+	PolicyGen uint32
+	_         [4]byte
+}
+
+type enforcerVerifyKey struct {
+	Okey struct {
+		PidNs uint32
+		MntNs uint32
+	}
+	Key enforcerBufsK
+}
+
 // loadEnforcer returns the embedded CollectionSpec for enforcer.
 func loadEnforcer() (*ebpf.CollectionSpec, error) {
 	reader := bytes.NewReader(_EnforcerBytes)
@@ -60,24 +154,45 @@ type enforcerSpecs struct {
 //
 // It can be passed ebpf.CollectionSpec.Assign.
 type enforcerProgramSpecs struct {
-	EnforceCap        *ebpf.ProgramSpec `ebpf:"enforce_cap"`
-	EnforceFile       *ebpf.ProgramSpec `ebpf:"enforce_file"`
-	EnforceFilePerm   *ebpf.ProgramSpec `ebpf:"enforce_file_perm"`
-	EnforceNetAccept  *ebpf.ProgramSpec `ebpf:"enforce_net_accept"`
-	EnforceNetConnect *ebpf.ProgramSpec `ebpf:"enforce_net_connect"`
-	EnforceNetCreate  *ebpf.ProgramSpec `ebpf:"enforce_net_create"`
-	EnforceProc       *ebpf.ProgramSpec `ebpf:"enforce_proc"`
+	EnforceCap         *ebpf.ProgramSpec `ebpf:"enforce_cap"`
+	EnforceFile        *ebpf.ProgramSpec `ebpf:"enforce_file"`
+	EnforceFilePerm    *ebpf.ProgramSpec `ebpf:"enforce_file_perm"`
+	EnforceNetAccept   *ebpf.ProgramSpec `ebpf:"enforce_net_accept"`
+	EnforceNetBind     *ebpf.ProgramSpec `ebpf:"enforce_net_bind"`
+	EnforceNetConnect  *ebpf.ProgramSpec `ebpf:"enforce_net_connect"`
+	EnforceNetCreate   *ebpf.ProgramSpec `ebpf:"enforce_net_create"`
+	EnforceProc        *ebpf.ProgramSpec `ebpf:"enforce_proc"`
+	FreeFileVerdict    *ebpf.ProgramSpec `ebpf:"free_file_verdict"`
+	InvalidateExeCache *ebpf.ProgramSpec `ebpf:"invalidate_exe_cache"`
 }
 
 // enforcerMapSpecs contains maps before they are loaded into the kernel.
 //
 // It can be passed ebpf.CollectionSpec.Assign.
 type enforcerMapSpecs struct {
-	Bufk                *ebpf.MapSpec `ebpf:"bufk"`
-	Bufs                *ebpf.MapSpec `ebpf:"bufs"`
-	BufsOff             *ebpf.MapSpec `ebpf:"bufs_off"`
-	KubearmorContainers *ebpf.MapSpec `ebpf:"kubearmor_containers"`
-	KubearmorEvents     *ebpf.MapSpec `ebpf:"kubearmor_events"`
+	AlertBuf               *ebpf.MapSpec `ebpf:"alert_buf"`
+	Bufk                   *ebpf.MapSpec `ebpf:"bufk"`
+	Bufs                   *ebpf.MapSpec `ebpf:"bufs"`
+	BufsOff                *ebpf.MapSpec `ebpf:"bufs_off"`
+	Dirk                   *ebpf.MapSpec `ebpf:"dirk"`
+	ExeScratch             *ebpf.MapSpec `ebpf:"exe_scratch"`
+	KubearmorAlertDedup    *ebpf.MapSpec `ebpf:"kubearmor_alert_dedup"`
+	KubearmorContainerHdr  *ebpf.MapSpec `ebpf:"kubearmor_container_hdr"`
+	KubearmorContainers    *ebpf.MapSpec `ebpf:"kubearmor_containers"`
+	KubearmorDirRules      *ebpf.MapSpec `ebpf:"kubearmor_dir_rules"`
+	KubearmorEvents        *ebpf.MapSpec `ebpf:"kubearmor_events"`
+	KubearmorExeCache      *ebpf.MapSpec `ebpf:"kubearmor_exe_cache"`
+	KubearmorFileVerdicts  *ebpf.MapSpec `ebpf:"kubearmor_file_verdicts"`
+	KubearmorHookStats     *ebpf.MapSpec `ebpf:"kubearmor_hook_stats"`
+	KubearmorNetRules      *ebpf.MapSpec `ebpf:"kubearmor_net_rules"`
+	KubearmorPathCache     *ebpf.MapSpec `ebpf:"kubearmor_path_cache"`
+	KubearmorPathGen       *ebpf.MapSpec `ebpf:"kubearmor_path_gen"`
+	KubearmorRuleVerify    *ebpf.MapSpec `ebpf:"kubearmor_rule_verify"`
+	KubearmorStatsCounters *ebpf.MapSpec `ebpf:"kubearmor_stats_counters"`
+	KubearmorVerdicts      *ebpf.MapSpec `ebpf:"kubearmor_verdicts"`
+	Pcache                 *ebpf.MapSpec `ebpf:"pcache"`
+	StatsZero              *ebpf.MapSpec `ebpf:"stats_zero"`
+	Verifyk                *ebpf.MapSpec `ebpf:"verifyk"`
 }
 
 // enforcerObjects contains all objects after they have been loaded into the kernel.
@@ -99,20 +214,56 @@ func (o *enforcerObjects) Close() error {
 //
 // It can be passed to loadEnforcerObjects or ebpf.CollectionSpec.LoadAndAssign.
 type enforcerMaps struct {
-	Bufk                *ebpf.Map `ebpf:"bufk"`
-	Bufs                *ebpf.Map `ebpf:"bufs"`
-	BufsOff             *ebpf.Map `ebpf:"bufs_off"`
-	KubearmorContainers *ebpf.Map `ebpf:"kubearmor_containers"`
-	KubearmorEvents     *ebpf.Map `ebpf:"kubearmor_events"`
+	AlertBuf               *ebpf.Map `ebpf:"alert_buf"`
+	Bufk                   *ebpf.Map `ebpf:"bufk"`
+	Bufs                   *ebpf.Map `ebpf:"bufs"`
+	BufsOff                *ebpf.Map `ebpf:"bufs_off"`
+	Dirk                   *ebpf.Map `ebpf:"dirk"`
+	ExeScratch             *ebpf.Map `ebpf:"exe_scratch"`
+	KubearmorAlertDedup    *ebpf.Map `ebpf:"kubearmor_alert_dedup"`
+	KubearmorContainerHdr  *ebpf.Map `ebpf:"kubearmor_container_hdr"`
+	KubearmorContainers    *ebpf.Map `ebpf:"kubearmor_containers"`
+	KubearmorDirRules      *ebpf.Map `ebpf:"kubearmor_dir_rules"`
+	KubearmorEvents        *ebpf.Map `ebpf:"kubearmor_events"`
+	KubearmorExeCache      *ebpf.Map `ebpf:"kubearmor_exe_cache"`
+	KubearmorFileVerdicts  *ebpf.Map `ebpf:"kubearmor_file_verdicts"`
+	KubearmorHookStats     *ebpf.Map `ebpf:"kubearmor_hook_stats"`
+	KubearmorNetRules      *ebpf.Map `ebpf:"kubearmor_net_rules"`
+	KubearmorPathCache     *ebpf.Map `ebpf:"kubearmor_path_cache"`
+	KubearmorPathGen       *ebpf.Map `ebpf:"kubearmor_path_gen"`
+	KubearmorRuleVerify    *ebpf.Map `ebpf:"kubearmor_rule_verify"`
+	KubearmorStatsCounters *ebpf.Map `ebpf:"kubearmor_stats_counters"`
+	KubearmorVerdicts      *ebpf.Map `ebpf:"kubearmor_verdicts"`
+	Pcache                 *ebpf.Map `ebpf:"pcache"`
+	StatsZero              *ebpf.Map `ebpf:"stats_zero"`
+	Verifyk                *ebpf.Map `ebpf:"verifyk"`
 }
 
 func (m *enforcerMaps) Close() error {
 	return _EnforcerClose(
+		m.AlertBuf,
 		m.Bufk,
 		m.Bufs,
 		m.BufsOff,
+		m.Dirk,
+		m.ExeScratch,
+		m.KubearmorAlertDedup,
+		m.KubearmorContainerHdr,
 		m.KubearmorContainers,
+		m.KubearmorDirRules,
 		m.KubearmorEvents,
+		m.KubearmorExeCache,
+		m.KubearmorFileVerdicts,
+		m.KubearmorHookStats,
+		m.KubearmorNetRules,
+		m.KubearmorPathCache,
+		m.KubearmorPathGen,
+		m.KubearmorRuleVerify,
+		m.KubearmorStatsCounters,
+		m.KubearmorVerdicts,
+		m.Pcache,
+		m.StatsZero,
+		m.Verifyk,
 	)
 }
 
@@ -120,13 +271,16 @@ func (m *enforcerMaps) Close() error {
 //
 // It can be passed to loadEnforcerObjects or ebpf.CollectionSpec.LoadAndAssign.
 type enforcerPrograms struct {
-	EnforceCap        *ebpf.Program `ebpf:"enforce_cap"`
-	EnforceFile       *ebpf.Program `ebpf:"enforce_file"`
-	EnforceFilePerm   *ebpf.Program `ebpf:"enforce_file_perm"`
-	EnforceNetAccept  *ebpf.Program `ebpf:"enforce_net_accept"`
-	EnforceNetConnect *ebpf.Program `ebpf:"enforce_net_connect"`
-	EnforceNetCreate  *ebpf.Program `ebpf:"enforce_net_create"`
-	EnforceProc       *ebpf.Program `ebpf:"enforce_proc"`
+	EnforceCap         *ebpf.Program `ebpf:"enforce_cap"`
+	EnforceFile        *ebpf.Program `ebpf:"enforce_file"`
+	EnforceFilePerm    *ebpf.Program `ebpf:"enforce_file_perm"`
+	EnforceNetAccept   *ebpf.Program `ebpf:"enforce_net_accept"`
+	EnforceNetBind     *ebpf.Program `ebpf:"enforce_net_bind"`
+	EnforceNetConnect  *ebpf.Program `ebpf:"enforce_net_connect"`
+	EnforceNetCreate   *ebpf.Program `ebpf:"enforce_net_create"`
+	EnforceProc        *ebpf.Program `ebpf:"enforce_proc"`
+	FreeFileVerdict    *ebpf.Program `ebpf:"free_file_verdict"`
+	InvalidateExeCache *ebpf.Program `ebpf:"invalidate_exe_cache"`
 }
 
 func (p *enforcerPrograms) Close() error {
@@ -135,9 +289,12 @@ func (p *enforcerPrograms) Close() error {
 		p.EnforceFile,
 		p.EnforceFilePerm,
 		p.EnforceNetAccept,
+		p.EnforceNetBind,
 		p.EnforceNetConnect,
 		p.EnforceNetCreate,
 		p.EnforceProc,
+		p.FreeFileVerdict,
+		p.InvalidateExeCache,
 	)
 }
 
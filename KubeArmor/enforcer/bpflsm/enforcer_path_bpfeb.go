@@ -12,6 +12,23 @@ import (
 	"github.com/cilium/ebpf"
 )
 
+type enforcer_pathAlertDedupKey struct {
+	Okey struct {
+		PidNs uint32
+		MntNs uint32
+	}
+	EventId uint32
+	Retval  int32
+	Path    uint64
+	Source  uint64
+}
+
+type enforcer_pathAlertDedupVal struct {
+	Count uint64
+	First uint64
+	Last  uint64
+}
+
 type enforcer_pathBufsK struct {
 	Path   [256]int8
 	Source [256]int8
@@ -19,6 +36,83 @@ type enforcer_pathBufsK struct {
 
 type enforcer_pathBufsT struct{ Buf [32768]int8 }
 
+type enforcer_pathContainerHdr struct {
+	Flags       uint32
+	PolicyGen   uint32
+	Posture     [4]uint8
+	AddrPosture [2]uint8
+	Pad         [2]uint8
+	CapDeny     uint64
+	CapAllow    uint64
+}
+
+type enforcer_pathDirKey struct {
+	Prefixlen uint32
+	Source    uint32
+	Path      [252]int8
+}
+
+type enforcer_pathExeCache struct {
+	Exe  uint64
+	Hash uint64
+	Path [256]int8
+}
+
+type enforcer_pathFileVerdict struct {
+	Source    uint64
+	PathGen   uint64
+	PolicyGen uint32
+	Pad       uint32
+}
+
+type enforcer_pathHookStats struct {
+	Count   uint64
+	Denied  uint64
+	TotalNs uint64
+	Hist    [32]uint64
+}
+
+type enforcer_pathPathCacheKey struct {
+	Dentry uint64
+	Mnt    uint64
+}
+
+type enforcer_pathPathCacheVal struct {
+	Gen        uint64
+	Parent     uint64
+	HashLen    uint64
+	Mountpoint uint64
+	Path       [256]int8
+}
+
+type enforcer_pathVerdictKey struct {
+	Okey struct {
+		PidNs uint32
+		MntNs uint32
+	}
+	Dentry uint64
+	Mnt    uint64
+	Source uint64
+	Id     uint32
+	Pad    uint32
+}
+
+type enforcer_pathVerdictVal struct {
+	PathGen   uint64
+	Parent    uint64
+	HashLen   uint64
+	PolicyGen uint32
+	_         [4]byte
+}
+
+type enforcer_pathVerifyKey struct {
+	Okey struct {
+		PidNs uint32
+		MntNs uint32
+	}
+	Key enforcer_pathBufsK
+}
+
 // loadEnforcer_path returns the embedded CollectionSpec for enforcer_path.
 func loadEnforcer_path() (*ebpf.CollectionSpec, error) {
 	reader := bytes.NewReader(_Enforcer_pathBytes)
@@ -71,17 +165,35 @@ type enforcer_pathProgramSpecs struct {
 	EnforceSymlink   *ebpf.ProgramSpec `ebpf:"enforce_symlink"`
 	EnforceTruncate  *ebpf.ProgramSpec `ebpf:"enforce_truncate"`
 	EnforceUnlink    *ebpf.ProgramSpec `ebpf:"enforce_unlink"`
+	InvalidateRename *ebpf.ProgramSpec `ebpf:"invalidate_rename"`
 }
 
 // enforcer_pathMapSpecs contains maps before they are loaded into the kernel.
 //
 // It can be passed ebpf.CollectionSpec.Assign.
 type enforcer_pathMapSpecs struct {
-	Bufk                *ebpf.MapSpec `ebpf:"bufk"`
-	Bufs                *ebpf.MapSpec `ebpf:"bufs"`
-	BufsOff             *ebpf.MapSpec `ebpf:"bufs_off"`
-	KubearmorContainers *ebpf.MapSpec `ebpf:"kubearmor_containers"`
-	KubearmorEvents     *ebpf.MapSpec `ebpf:"kubearmor_events"`
+	AlertBuf               *ebpf.MapSpec `ebpf:"alert_buf"`
+	Bufk                   *ebpf.MapSpec `ebpf:"bufk"`
+	Bufs                   *ebpf.MapSpec `ebpf:"bufs"`
+	BufsOff                *ebpf.MapSpec `ebpf:"bufs_off"`
+	Dirk                   *ebpf.MapSpec `ebpf:"dirk"`
+	ExeScratch             *ebpf.MapSpec `ebpf:"exe_scratch"`
+	KubearmorAlertDedup    *ebpf.MapSpec `ebpf:"kubearmor_alert_dedup"`
+	KubearmorContainerHdr  *ebpf.MapSpec `ebpf:"kubearmor_container_hdr"`
+	KubearmorContainers    *ebpf.MapSpec `ebpf:"kubearmor_containers"`
+	KubearmorDirRules      *ebpf.MapSpec `ebpf:"kubearmor_dir_rules"`
+	KubearmorEvents        *ebpf.MapSpec `ebpf:"kubearmor_events"`
+	KubearmorExeCache      *ebpf.MapSpec `ebpf:"kubearmor_exe_cache"`
+	KubearmorFileVerdicts  *ebpf.MapSpec `ebpf:"kubearmor_file_verdicts"`
+	KubearmorHookStats     *ebpf.MapSpec `ebpf:"kubearmor_hook_stats"`
+	KubearmorPathCache     *ebpf.MapSpec `ebpf:"kubearmor_path_cache"`
+	KubearmorPathGen       *ebpf.MapSpec `ebpf:"kubearmor_path_gen"`
+	KubearmorRuleVerify    *ebpf.MapSpec `ebpf:"kubearmor_rule_verify"`
+	KubearmorStatsCounters *ebpf.MapSpec `ebpf:"kubearmor_stats_counters"`
+	KubearmorVerdicts      *ebpf.MapSpec `ebpf:"kubearmor_verdicts"`
+	Pcache                 *ebpf.MapSpec `ebpf:"pcache"`
+	StatsZero              *ebpf.MapSpec `ebpf:"stats_zero"`
+	Verifyk                *ebpf.MapSpec `ebpf:"verifyk"`
 }
 
 // enforcer_pathObjects contains all objects after they have been loaded into the kernel.
@@ -103,20 +215,54 @@ func (o *enforcer_pathObjects) Close() error {
 //
 // It can be passed to loadEnforcer_pathObjects or ebpf.CollectionSpec.LoadAndAssign.
 type enforcer_pathMaps struct {
-	Bufk                *ebpf.Map `ebpf:"bufk"`
-	Bufs                *ebpf.Map `ebpf:"bufs"`
-	BufsOff             *ebpf.Map `ebpf:"bufs_off"`
-	KubearmorContainers *ebpf.Map `ebpf:"kubearmor_containers"`
-	KubearmorEvents     *ebpf.Map `ebpf:"kubearmor_events"`
+	AlertBuf               *ebpf.Map `ebpf:"alert_buf"`
+	Bufk                   *ebpf.Map `ebpf:"bufk"`
+	Bufs                   *ebpf.Map `ebpf:"bufs"`
+	BufsOff                *ebpf.Map `ebpf:"bufs_off"`
+	Dirk                   *ebpf.Map `ebpf:"dirk"`
+	ExeScratch             *ebpf.Map `ebpf:"exe_scratch"`
+	KubearmorAlertDedup    *ebpf.Map `ebpf:"kubearmor_alert_dedup"`
+	KubearmorContainerHdr  *ebpf.Map `ebpf:"kubearmor_container_hdr"`
+	KubearmorContainers    *ebpf.Map `ebpf:"kubearmor_containers"`
+	KubearmorDirRules      *ebpf.Map `ebpf:"kubearmor_dir_rules"`
+	KubearmorEvents        *ebpf.Map `ebpf:"kubearmor_events"`
+	KubearmorExeCache      *ebpf.Map `ebpf:"kubearmor_exe_cache"`
+	KubearmorFileVerdicts  *ebpf.Map `ebpf:"kubearmor_file_verdicts"`
+	KubearmorHookStats     *ebpf.Map `ebpf:"kubearmor_hook_stats"`
+	KubearmorPathCache     *ebpf.Map `ebpf:"kubearmor_path_cache"`
+	KubearmorPathGen       *ebpf.Map `ebpf:"kubearmor_path_gen"`
+	KubearmorRuleVerify    *ebpf.Map `ebpf:"kubearmor_rule_verify"`
+	KubearmorStatsCounters *ebpf.Map `ebpf:"kubearmor_stats_counters"`
+	KubearmorVerdicts      *ebpf.Map `ebpf:"kubearmor_verdicts"`
+	Pcache                 *ebpf.Map `ebpf:"pcache"`
+	StatsZero              *ebpf.Map `ebpf:"stats_zero"`
+	Verifyk                *ebpf.Map `ebpf:"verifyk"`
 }
 
 func (m *enforcer_pathMaps) Close() error {
 	return _Enforcer_pathClose(
+		m.AlertBuf,
 		m.Bufk,
 		m.Bufs,
 		m.BufsOff,
+		m.Dirk,
+		m.ExeScratch,
+		m.KubearmorAlertDedup,
+		m.KubearmorContainerHdr,
 		m.KubearmorContainers,
+		m.KubearmorDirRules,
 		m.KubearmorEvents,
+		m.KubearmorExeCache,
+		m.KubearmorFileVerdicts,
+		m.KubearmorHookStats,
+		m.KubearmorPathCache,
+		m.KubearmorPathGen,
+		m.KubearmorRuleVerify,
+		m.KubearmorStatsCounters,
+		m.KubearmorVerdicts,
+		m.Pcache,
+		m.StatsZero,
+		m.Verifyk,
 	)
 }
 
@@ -135,6 +281,7 @@ type enforcer_pathPrograms struct {
 	EnforceSymlink   *ebpf.Program `ebpf:"enforce_symlink"`
 	EnforceTruncate  *ebpf.Program `ebpf:"enforce_truncate"`
 	EnforceUnlink    *ebpf.Program `ebpf:"enforce_unlink"`
+	InvalidateRename *ebpf.Program `ebpf:"invalidate_rename"`
 }
 
 func (p *enforcer_pathPrograms) Close() error {
@@ -150,6 +297,7 @@ func (p *enforcer_pathPrograms) Close() error {
 		p.EnforceSymlink,
 		p.EnforceTruncate,
 		p.EnforceUnlink,
+		p.InvalidateRename,
 	)
 }
 
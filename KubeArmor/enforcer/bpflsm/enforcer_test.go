@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Authors of KubeArmor
+
+package bpflsm
+
+import (
+	"bytes"
+	"encoding/binary"
+	"strings"
+	"testing"
+
+	mon "github.com/kubearmor/KubeArmor/KubeArmor/monitor"
+)
+
+func record(t *testing.T, hdr alertHeader, data string) []byte {
+	t.Helper()
+	var buf bytes.Buffer
+	if err := binary.Write(&buf, binary.LittleEndian, hdr); err != nil {
+		t.Fatal(err)
+	}
+	buf.WriteString(data)
+	return buf.Bytes()
+}
+
+func TestDecodeEvent(t *testing.T) {
+	hdr := alertHeader{PID: 42, EventID: mon.FileOpen, Retval: -13, Repeat: 3}
+	copy(hdr.Comm[:], "cat")
+	hdr.PathLen = uint16(len("/etc/shadow\x00"))
+	hdr.SourceLen = uint16(len("/bin/cat\x00"))
+
+	var event eventBPF
+	if err := decodeEvent(record(t, hdr, "/etc/shadow\x00/bin/cat\x00"), &event); err != nil {
+		t.Fatalf("decodeEvent: %s", err)
+	}
+
+	if event.alertHeader != hdr {
+		t.Errorf("header = %+v, want %+v", event.alertHeader, hdr)
+	}
+	if path := strings.TrimRight(string(event.Data.Path[:]), "\x00"); path != "/etc/shadow" {
+		t.Errorf("path = %q, want %q", path, "/etc/shadow")
+	}
+	if source := strings.TrimRight(string(event.Data.Source[:]), "\x00"); source != "/bin/cat" {
+		t.Errorf("source = %q, want %q", source, "/bin/cat")
+	}
+
+	// records shorter than their lengths claim
+	if err := decodeEvent(record(t, hdr, "/etc/shadow\x00"), &event); err == nil {
+		t.Errorf("decodeEvent accepted a truncated record")
+	}
+	if err := decodeEvent(record(t, hdr, "")[:10], &event); err == nil {
+		t.Errorf("decodeEvent accepted a truncated header")
+	}
+}
+
+func TestNetAddrResource(t *testing.T) {
+	encode := func(family uint8, hexPort, hexAddr string) []byte {
+		var path [256]byte
+		path[0] = 4 // sock_addr
+		path[1] = family
+		copy(path[2:], hexPort+hexAddr)
+		return path[:]
+	}
+
+	for _, tc := range []struct {
+		eventID int32
+		path    []byte
+		want    string
+	}{
+		{mon.SocketConnect, encode(afInet, "01bb", "0a010203"), "remoteip=10.1.2.3 port=443"},
+		{mon.SocketBind, encode(afInet, "1f90", "00000000"), "localip=0.0.0.0 port=8080"},
+		{mon.SocketConnect, encode(afInet6, "0035", "20010db8000000000000000000000001"), "remoteip=2001:db8::1 port=53"},
+		// IPv4-mapped addresses are reported as IPv4 by the BPF programs
+		{mon.SocketConnect, encode(afInet, "0050", "c0a80001"), "remoteip=192.168.0.1 port=80"},
+		{mon.SocketConnect, encode(afInet, "0050", "c0a8zz01"), ""},
+		{mon.SocketConnect, encode(afInet, "zz50", "c0a80001"), ""},
+	} {
+		if got := netAddrResource(tc.eventID, tc.path); got != tc.want {
+			t.Errorf("netAddrResource(%d, %q) = %q, want %q", tc.eventID, tc.path[:40], got, tc.want)
+		}
+	}
+}
+
+func TestEmbeddedObjects(t *testing.T) {
+	// the objects are rebuilt from BPF/ with go generate, bindings listing maps or programs they lack fail to load
+	spec, err := loadEnforcer()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := spec.Assign(&enforcerSpecs{}); err != nil {
+		t.Errorf("enforcer object does not match its bindings, run go generate: %s", err)
+	}
+
+	spec, err = loadEnforcer_path()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := spec.Assign(&enforcer_pathSpecs{}); err != nil {
+		t.Errorf("enforcer_path object does not match its bindings, run go generate: %s", err)
+	}
+}
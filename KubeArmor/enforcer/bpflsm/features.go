@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Authors of KubeArmor
+
+package bpflsm
+
+import (
+	"github.com/cilium/ebpf"
+	"github.com/cilium/ebpf/asm"
+	"github.com/cilium/ebpf/btf"
+	"github.com/cilium/ebpf/features"
+
+	probe "github.com/kubearmor/KubeArmor/KubeArmor/utils/bpflsmprobe"
+)
+
+// bpfFeatures contains the optional kernel features used by the BPF LSM programs, they are probed once at startup
+type bpfFeatures struct {
+	TaskStorage bool
+	BPFLoop     bool
+	DPath       bool
+}
+
+// probeFeatures checks which of the optional kernel features are available
+func probeFeatures() bpfFeatures {
+	var f bpfFeatures
+
+	f.TaskStorage = features.HaveMapType(ebpf.TaskStorage) == nil
+	// bpf_loop is a base helper, available to LSM programs if it is available to kprobes
+	f.BPFLoop = features.HaveProgramHelper(ebpf.Kprobe, asm.FnLoop) == nil
+	// bpf_d_path is only allowed in some hooks, the probe loads programs using it in the file hooks
+	f.DPath = probe.CheckBPFDPathSupport() == nil
+
+	return f
+}
+
+// constants returns the values of the `const volatile` globals configuring the BPF programs
+func (be *BPFEnforcer) constants() map[string]interface{} {
+	return map[string]interface{}{
+		"exe_cache_enabled":  be.features.TaskStorage,
+		"path_loop_enabled":  be.features.BPFLoop,
+		"d_path_enabled":     be.features.DPath,
+		"compact_keys":       be.CompactKeys,
+		"hash_seed":          be.hashSeed,
+		"alert_dedup_window": uint64(be.alertDedupWindow.Nanoseconds()),
+	}
+}
+
+// loadObjects loads a collection configured for the available features and assigns it to obj
+func (be *BPFEnforcer) loadObjects(load func() (*ebpf.CollectionSpec, error), obj interface{}, opts *ebpf.CollectionOptions) error {
+	spec, err := load()
+	if err != nil {
+		return err
+	}
+
+	if !be.features.TaskStorage {
+		// programs using the map are dead code, it just needs to be loadable
+		if m, ok := spec.Maps["kubearmor_exe_cache"]; ok {
+			m.Type = ebpf.Hash
+			m.MaxEntries = 1
+		}
+	}
+
+	if !be.features.BPFLoop {
+		dropCallbacks(spec)
+	}
+
+	// the outer maps are shared with the maps created by NewBPFEnforcer and need the same size
+	for _, name := range outerMaps {
+		if m, ok := spec.Maps[name]; ok {
+			m.MaxEntries = be.maxContainers
+		}
+	}
+
+	if err := rewriteConstants(spec, be.constants()); err != nil {
+		return err
+	}
+
+	return spec.LoadAndAssign(obj, opts)
+}
+
+// rewriteConstants sets the constants declared by the collection, the enforcer objects do not all declare the same ones
+func rewriteConstants(spec *ebpf.CollectionSpec, consts map[string]interface{}) error {
+	rodata, ok := spec.Maps[".rodata"]
+	if !ok {
+		return nil
+	}
+
+	ds, ok := rodata.Value.(*btf.Datasec)
+	if !ok {
+		return nil
+	}
+
+	declared := make(map[string]interface{})
+	for _, vsi := range ds.Vars {
+		if v, ok := vsi.Type.(*btf.Var); ok {
+			if val, ok := consts[v.Name]; ok {
+				declared[v.Name] = val
+			}
+		}
+	}
+
+	return spec.RewriteConstants(declared)
+}
+
+// dropCallbacks replaces the callback references passed to bpf_loop with 0, kernels without bpf_loop reject any
+// reference to a callback even though the calls are dead code there. The callbacks are no longer linked in then
+func dropCallbacks(spec *ebpf.CollectionSpec) {
+	for _, prog := range spec.Programs {
+		for i, ins := range prog.Instructions {
+			if !ins.IsLoadOfFunctionPointer() {
+				continue
+			}
+			nop := asm.LoadImm(ins.Dst, 0, asm.DWord).WithSource(ins.Source())
+			if sym := ins.Symbol(); sym != "" {
+				nop = nop.WithSymbol(sym)
+			}
+			prog.Instructions[i] = nop
+		}
+	}
+}
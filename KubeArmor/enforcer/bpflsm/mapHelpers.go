@@ -5,16 +5,32 @@ package bpflsm
 
 import (
 	"errors"
+	"math"
 	"os"
+	"path/filepath"
+	"strconv"
 
 	"github.com/cilium/ebpf"
+	"golang.org/x/sys/unix"
 )
 
+const (
+	// defaultMaxContainers is the size of the outer maps if neither the configuration nor the node capacity sets it
+	defaultMaxContainers = 256
+	// containersPerPod leaves room for init and sidecar containers when the outer maps are sized from the pod capacity
+	containersPerPod = 4
+)
+
+// outerMaps contains the names of the maps holding one entry per container, they all have the same size
+var outerMaps = []string{"kubearmor_containers", "kubearmor_dir_rules", "kubearmor_net_rules", "kubearmor_container_hdr"}
+
 // ContainerKV contains Keys for individual container eBPF Map and the Map itself
 type ContainerKV struct {
-	Key   NsKey
-	Map   *ebpf.Map
-	Rules RuleList
+	Key    NsKey
+	Map    *ebpf.Map
+	DirMap *ebpf.Map
+	NetMap *ebpf.Map
+	Rules  RuleList
 }
 
 // NsKey Structure acts as an Identifier for containers
@@ -29,6 +45,67 @@ type InnerKey struct {
 	Source [256]byte
 }
 
+// RuleKey Structure contains the compact Map Rule Identifier, hashes of the path and source of InnerKey
+type RuleKey struct {
+	Path   uint64
+	Source uint64
+}
+
+// VerifyKey Structure contains the full Map Rule Identifier of rules whose compact keys collide
+type VerifyKey struct {
+	NsKey NsKey
+	Key   InnerKey
+}
+
+// ContainerHeader Structure contains the rule classes, postures and policy generation of a container
+type ContainerHeader struct {
+	Flags       uint32
+	PolicyGen   uint32
+	Posture     [4]uint8
+	AddrPosture [2]uint8
+	Pad         [2]uint8
+	CapDeny     uint64
+	CapAllow    uint64
+}
+
+// DirKey Structure contains Directory Rule Identifier for the LPM Trie
+type DirKey struct {
+	PrefixLen uint32
+	Source    uint32
+	Path      [252]byte
+}
+
+// DirValue Structure contains the rule set on the directory, the rule inherited from the closest recursive parent directory
+// and the source path of fromSource rules
+type DirValue struct {
+	Self    [2]uint8
+	Inherit [2]uint8
+	Len     uint16
+	Source  [256]byte
+}
+
+// NetAddrKey Structure contains Address Rule Identifier for the LPM Trie
+type NetAddrKey struct {
+	PrefixLen uint32
+	Op        uint8
+	Family    uint8
+	Addr      [16]byte
+	Pad       [2]uint8
+}
+
+// NetPortRange Structure contains a port range of an address rule and the rule set on it
+type NetPortRange struct {
+	Lo   uint16
+	Hi   uint16
+	Rule [2]uint8
+}
+
+// NetAddrValue Structure contains the port range table of an address prefix
+type NetAddrValue struct {
+	Count uint32
+	Ports [MaxNetPortRanges]NetPortRange
+}
+
 // AddContainerIDToMap adds container metadata to Outer eBPF container Map for initialising enforcement tracking and initiates an InnerMap to store the container specific rules
 func (be *BPFEnforcer) AddContainerIDToMap(containerID string, pidns, mntns uint32) {
 	key := NsKey{PidNS: pidns, MntNS: mntns}
@@ -52,10 +129,31 @@ func (be *BPFEnforcer) CreateContainerInnerMap(containerID string) {
 			return
 		}
 
-		be.ContainerMap[containerID] = ContainerKV{Key: val.Key, Map: im, Rules: val.Rules}
-		if err := be.BPFContainerMap.Put(val.Key, im); err != nil {
+		dm, err := ebpf.NewMap(be.InnerDirMapSpec)
+		if err != nil {
+			be.Logger.Errf("error creating container directory map for %s: %s", containerID, err)
+			im.Close()
+			return
+		}
+
+		nm, err := ebpf.NewMap(be.InnerNetMapSpec)
+		if err != nil {
+			be.Logger.Errf("error creating container address map for %s: %s", containerID, err)
+			im.Close()
+			dm.Close()
+			return
+		}
+
+		be.ContainerMap[containerID] = ContainerKV{Key: val.Key, Map: im, DirMap: dm, NetMap: nm, Rules: val.Rules}
+		if err := be.putContainer(be.BPFContainerMap, val.Key, im); err != nil {
 			be.Logger.Errf("error adding container %s to outer map: %s", containerID, err)
 		}
+		if err := be.putContainer(be.BPFContainerDirMap, val.Key, dm); err != nil {
+			be.Logger.Errf("error adding container %s to outer directory map: %s", containerID, err)
+		}
+		if err := be.putContainer(be.BPFContainerNetMap, val.Key, nm); err != nil {
+			be.Logger.Errf("error adding container %s to outer address map: %s", containerID, err)
+		}
 	}
 }
 
@@ -81,8 +179,40 @@ func (be *BPFEnforcer) DeleteContainerInnerMap(containerID string) {
 		if err := be.ContainerMap[containerID].Map.Close(); err != nil {
 			be.Logger.Errf("error closing container map for %s: %s", containerID, err)
 		}
+		if be.ContainerMap[containerID].DirMap != nil {
+			if err := be.BPFContainerDirMap.Delete(be.ContainerMap[containerID].Key); err != nil {
+				if !errors.Is(err, os.ErrNotExist) {
+					be.Logger.Errf("error deleting container %s from outer directory map: %s", containerID, err.Error())
+				}
+			}
+			if err := be.ContainerMap[containerID].DirMap.Close(); err != nil {
+				be.Logger.Errf("error closing container directory map for %s: %s", containerID, err)
+			}
+		}
+		if be.ContainerMap[containerID].NetMap != nil {
+			if err := be.BPFContainerNetMap.Delete(be.ContainerMap[containerID].Key); err != nil {
+				if !errors.Is(err, os.ErrNotExist) {
+					be.Logger.Errf("error deleting container %s from outer address map: %s", containerID, err.Error())
+				}
+			}
+			if err := be.ContainerMap[containerID].NetMap.Close(); err != nil {
+				be.Logger.Errf("error closing container address map for %s: %s", containerID, err)
+			}
+		}
+		if err := be.ContainerHdrMap.Delete(be.ContainerMap[containerID].Key); err != nil {
+			if !errors.Is(err, os.ErrNotExist) {
+				be.Logger.Errf("error deleting container %s from header map: %s", containerID, err.Error())
+			}
+		}
+		verify := []InnerKey{}
+		for key := range be.ContainerMap[containerID].Rules.VerifyKeys {
+			verify = append(verify, key)
+		}
+		be.deleteVerifyKeys(containerID, verify)
 		val := be.ContainerMap[containerID]
 		val.Map = nil
+		val.DirMap = nil
+		val.NetMap = nil
 		val.Rules.Init()
 		be.ContainerMap[containerID] = val
 	}
@@ -101,12 +231,444 @@ func (be *BPFEnforcer) AddHostToMap() {
 		return
 	}
 
+	dm, err := ebpf.NewMap(be.InnerDirMapSpec)
+	if err != nil {
+		be.Logger.Errf("error creating host directory policy map: %s", err)
+		im.Close()
+		return
+	}
+
+	nm, err := ebpf.NewMap(be.InnerNetMapSpec)
+	if err != nil {
+		be.Logger.Errf("error creating host address policy map: %s", err)
+		im.Close()
+		dm.Close()
+		return
+	}
+
 	var rules RuleList
 
 	rules.Init()
 
-	be.ContainerMap["host"] = ContainerKV{Key: key, Map: im, Rules: rules}
-	if err := be.BPFContainerMap.Put(key, im); err != nil {
+	be.ContainerMap["host"] = ContainerKV{Key: key, Map: im, DirMap: dm, NetMap: nm, Rules: rules}
+	if err := be.putContainer(be.BPFContainerMap, key, im); err != nil {
 		be.Logger.Errf("error adding host to outer map: %s", err)
 	}
+	if err := be.putContainer(be.BPFContainerDirMap, key, dm); err != nil {
+		be.Logger.Errf("error adding host to outer directory map: %s", err)
+	}
+	if err := be.putContainer(be.BPFContainerNetMap, key, nm); err != nil {
+		be.Logger.Errf("error adding host to outer address map: %s", err)
+	}
+}
+
+// maxContainers returns the size of the outer maps, a configured size takes precedence over the pod capacity of the node
+func maxContainers(configured, podCapacity int) uint32 {
+	if configured > 0 {
+		return uint32(configured)
+	}
+	// one more entry for the host
+	return uint32(max(podCapacity*containersPerPod+1, defaultMaxContainers))
+}
+
+// removeStalePins removes the outer maps pinned by an earlier run which could not be reused, either because of another size
+// or because their inner maps have another layout, as after toggling bpfCompactKeys
+func (be *BPFEnforcer) removeStalePins(pinpath string) {
+	inner := map[string]*ebpf.MapSpec{
+		"kubearmor_containers": be.InnerMapSpec,
+		"kubearmor_dir_rules":  be.InnerDirMapSpec,
+		"kubearmor_net_rules":  be.InnerNetMapSpec,
+	}
+
+	for _, name := range outerMaps {
+		path := filepath.Join(pinpath, name)
+
+		m, err := ebpf.LoadPinnedMap(path, nil)
+		if err != nil {
+			continue
+		}
+		stale := m.MaxEntries() != be.maxContainers
+		if spec, ok := inner[name]; ok && !stale {
+			stale = !innerMapCompatible(m, spec)
+		}
+		m.Close()
+
+		if !stale {
+			continue
+		}
+		if err := os.Remove(path); err != nil && !errors.Is(err, os.ErrNotExist) {
+			be.Logger.Warnf("error removing stale %s map: %s", name, err)
+		}
+	}
+}
+
+// innerMapCompatible checks if maps created from spec can be stored in the outer map. The kernel compares them with the
+// inner map the outer map was created with, which can not be read back, so a map is stored under a key no container has
+func innerMapCompatible(outer *ebpf.Map, spec *ebpf.MapSpec) bool {
+	im, err := ebpf.NewMap(spec)
+	if err != nil {
+		return true
+	}
+	defer im.Close()
+
+	// only the host has a zero pid namespace
+	key := NsKey{PidNS: 0, MntNS: math.MaxUint32}
+	if err := outer.Update(key, im, ebpf.UpdateNoExist); err != nil {
+		// a full map does not tell, only a mismatching inner map is rejected with EINVAL
+		return !errors.Is(err, unix.EINVAL)
+	}
+	if err := outer.Delete(key); err != nil && !errors.Is(err, os.ErrNotExist) {
+		return false
+	}
+	return true
+}
+
+// putContainer adds the entry of a container to an outer map, the entries of exited containers are reclaimed if the map is full
+func (be *BPFEnforcer) putContainer(outer *ebpf.Map, key NsKey, val interface{}) error {
+	err := outer.Put(key, val)
+	if errors.Is(err, unix.E2BIG) && be.reclaimContainers(key) > 0 {
+		err = outer.Put(key, val)
+	}
+	return err
+}
+
+// reclaimContainers frees the outer map entries of containers which exited without their removal being seen, that is
+// containers whose namespaces are gone and entries no container is known for. It returns the number of entries freed
+func (be *BPFEnforcer) reclaimContainers(keep NsKey) int {
+	live := liveNamespaces()
+	known := map[NsKey]struct{}{keep: {}}
+	reclaimed := 0
+
+	for id, ckv := range be.ContainerMap {
+		if ckv.Map == nil {
+			continue
+		}
+		if _, ok := live[ckv.Key]; ok || live == nil || ckv.Key == keep || id == "host" {
+			known[ckv.Key] = struct{}{}
+			continue
+		}
+		be.Logger.Printf("Reclaiming BPF maps of exited container %s", id)
+		be.DeleteContainerInnerMap(id)
+		reclaimed++
+	}
+
+	for _, outer := range []*ebpf.Map{be.BPFContainerMap, be.BPFContainerDirMap, be.BPFContainerNetMap, be.ContainerHdrMap} {
+		var stale []NsKey
+		var prev interface{}
+
+		for {
+			var key NsKey
+			if err := outer.NextKey(prev, &key); err != nil {
+				if !errors.Is(err, ebpf.ErrKeyNotExist) {
+					be.Logger.Warnf("error iterating outer map %s: %s", outer.String(), err)
+				}
+				break
+			}
+			if _, ok := known[key]; !ok {
+				stale = append(stale, key)
+			}
+			prev = key
+		}
+
+		for _, key := range stale {
+			if err := outer.Delete(key); err == nil {
+				reclaimed++
+			} else if !errors.Is(err, os.ErrNotExist) {
+				be.Logger.Warnf("error reclaiming entry %v of outer map %s: %s", key, outer.String(), err)
+			}
+		}
+	}
+
+	return reclaimed
+}
+
+// liveNamespaces returns the pid and mount namespaces of the running processes, nil if they can not be read
+func liveNamespaces() map[NsKey]struct{} {
+	entries, err := os.ReadDir("/proc")
+	if err != nil {
+		return nil
+	}
+
+	live := make(map[NsKey]struct{})
+	for _, entry := range entries {
+		if _, err := strconv.Atoi(entry.Name()); err != nil {
+			continue
+		}
+		var pidns, mntns unix.Stat_t
+		if unix.Stat(filepath.Join("/proc", entry.Name(), "ns/pid"), &pidns) != nil ||
+			unix.Stat(filepath.Join("/proc", entry.Name(), "ns/mnt"), &mntns) != nil {
+			continue
+		}
+		live[NsKey{PidNS: uint32(pidns.Ino), MntNS: uint32(mntns.Ino)}] = struct{}{}
+	}
+
+	return live
+}
+
+// deleteRules removes rules from the container map, rules which are not in the map are skipped
+func (be *BPFEnforcer) deleteRules(id string, keys []InnerKey) error {
+	if !be.CompactKeys {
+		return batchDelete(be.ContainerMap[id].Map, keys, be.mapBatchSize)
+	}
+
+	compact := make([]RuleKey, 0, len(keys))
+	for _, key := range keys {
+		compact = append(compact, be.compactKey(key))
+	}
+	return batchDelete(be.ContainerMap[id].Map, compact, be.mapBatchSize)
+}
+
+// verifyRule stores the full key of a rule whose compact key collides in the verify map and returns the value pointing the BPF programs to it
+func (be *BPFEnforcer) verifyRule(ckv ContainerKV, key InnerKey, val [2]uint8) ([2]uint8, error) {
+	if !ckv.Rules.VerifyKeys[key] {
+		return val, nil
+	}
+
+	if err := be.BPFRuleVerifyMap.Put(VerifyKey{NsKey: ckv.Key, Key: key}, val); err != nil {
+		return val, err
+	}
+
+	return [2]uint8{0, VERIFY}, nil
+}
+
+// updateVerifyKeys finds the rules whose compact keys collide and returns the verify map entries which are not needed anymore
+func (be *BPFEnforcer) updateVerifyKeys(id string, lists ...map[InnerKey][2]uint8) []InnerKey {
+	seen := make(map[RuleKey]InnerKey)
+	verify := make(map[InnerKey]bool)
+
+	for _, list := range lists {
+		for key := range list {
+			rk := be.compactKey(key)
+			if other, ok := seen[rk]; ok && other != key {
+				verify[key] = true
+				verify[other] = true
+			} else {
+				seen[rk] = key
+			}
+		}
+	}
+
+	ckv := be.ContainerMap[id]
+
+	stale := []InnerKey{}
+	for key := range ckv.Rules.VerifyKeys {
+		if !verify[key] {
+			stale = append(stale, key)
+		}
+	}
+
+	if len(verify) > 0 {
+		be.Logger.Printf("%d rules of %s have colliding compact keys", len(verify), id)
+	}
+
+	ckv.Rules.VerifyKeys = verify
+	be.ContainerMap[id] = ckv
+
+	return stale
+}
+
+// deleteVerifyKeys removes the given rules of the container from the verify map
+func (be *BPFEnforcer) deleteVerifyKeys(id string, keys []InnerKey) {
+	verify := make([]VerifyKey, 0, len(keys))
+	for _, key := range keys {
+		verify = append(verify, VerifyKey{NsKey: be.ContainerMap[id].Key, Key: key})
+	}
+	if err := batchDelete(be.BPFRuleVerifyMap, verify, be.mapBatchSize); err != nil {
+		be.Logger.Errf("error deleting rules of container %s from verify map: %s", id, err)
+	}
+}
+
+// swapContainerMaps fills new inner maps with the complete rule set of the container and replaces the entries of the outer maps with them,
+// the BPF programs keep enforcing the previous rules until the swap instead of seeing a half applied policy. On error all outer maps
+// still hold the previous inner maps and the caller must not publish the header of the new rules
+func (be *BPFEnforcer) swapContainerMaps(id string, rules map[InnerKey][2]uint8, dirs map[DirKey]DirValue, addrs map[NetAddrKey]NetAddrValue) error {
+	ckv := be.ContainerMap[id]
+
+	im, err := ebpf.NewMap(be.InnerMapSpec)
+	if err != nil {
+		return err
+	}
+
+	dm, err := ebpf.NewMap(be.InnerDirMapSpec)
+	if err != nil {
+		im.Close()
+		return err
+	}
+
+	nm, err := ebpf.NewMap(be.InnerNetMapSpec)
+	if err != nil {
+		im.Close()
+		dm.Close()
+		return err
+	}
+
+	if err := be.putRules(ckv, im, rules); err == nil {
+		if err = putMap(dm, dirs, be.mapBatchSize); err == nil {
+			err = putMap(nm, addrs, be.mapBatchSize)
+		}
+	}
+	if err != nil {
+		im.Close()
+		dm.Close()
+		nm.Close()
+		return err
+	}
+
+	// Replacing an outer map entry is atomic for the BPF programs, a lookup returns either the previous inner map or the new one.
+	// The outer maps are updated one after the other, if one of them fails the ones already swapped get their previous inner
+	// map back so the container is never left with a mix of old and new rules
+	outers := []*ebpf.Map{be.BPFContainerMap, be.BPFContainerDirMap, be.BPFContainerNetMap}
+	prev := []*ebpf.Map{ckv.Map, ckv.DirMap, ckv.NetMap}
+	next := []*ebpf.Map{im, dm, nm}
+
+	for i, outer := range outers {
+		if err := be.putContainer(outer, ckv.Key, next[i]); err != nil {
+			for j := i - 1; j >= 0; j-- {
+				be.restoreInnerMap(id, outers[j], ckv.Key, prev[j])
+			}
+			im.Close()
+			dm.Close()
+			nm.Close()
+			return err
+		}
+	}
+
+	// The kernel frees the previous inner maps once the programs using them are done
+	for _, m := range prev {
+		if m != nil {
+			m.Close()
+		}
+	}
+
+	ckv.Map, ckv.DirMap, ckv.NetMap = im, dm, nm
+	be.ContainerMap[id] = ckv
+
+	return nil
+}
+
+// restoreInnerMap puts the previous inner map of the container back into an outer map after a failed swap
+func (be *BPFEnforcer) restoreInnerMap(id string, outer *ebpf.Map, key NsKey, prev *ebpf.Map) {
+	var err error
+	if prev != nil {
+		err = outer.Put(key, prev)
+	} else {
+		err = outer.Delete(key)
+	}
+	if err != nil {
+		be.Logger.Errf("error restoring inner map of container %s: %s", id, err)
+	}
+}
+
+// putRules writes the rules to a container map
+func (be *BPFEnforcer) putRules(ckv ContainerKV, m *ebpf.Map, rules map[InnerKey][2]uint8) error {
+	vals := make([][2]uint8, 0, len(rules))
+
+	if !be.CompactKeys {
+		keys := make([]InnerKey, 0, len(rules))
+		for key, val := range rules {
+			keys = append(keys, key)
+			vals = append(vals, val)
+		}
+		return batchPut(m, keys, vals, be.mapBatchSize)
+	}
+
+	keys := make([]RuleKey, 0, len(rules))
+	for key, val := range rules {
+		val, err := be.verifyRule(ckv, key, val)
+		if err != nil {
+			return err
+		}
+		keys = append(keys, be.compactKey(key))
+		vals = append(vals, val)
+	}
+	return batchPut(m, keys, vals, be.mapBatchSize)
+}
+
+// putMap writes the entries to the map with batchPut
+func putMap[K comparable, V any](m *ebpf.Map, entries map[K]V, size int) error {
+	keys := make([]K, 0, len(entries))
+	vals := make([]V, 0, len(entries))
+	for key, val := range entries {
+		keys = append(keys, key)
+		vals = append(vals, val)
+	}
+	return batchPut(m, keys, vals, size)
+}
+
+// batchMap contains the operations of *ebpf.Map used by batchPut and batchDelete
+type batchMap interface {
+	BatchUpdate(keys, values interface{}, opts *ebpf.BatchOptions) (int, error)
+	BatchDelete(keys interface{}, opts *ebpf.BatchOptions) (int, error)
+	Put(key, value interface{}) error
+	Delete(key interface{}) error
+}
+
+// batchPut writes the entries to the map in batches of up to size entries, and with one update per entry on kernels without batch operations
+func batchPut[K, V any](m batchMap, keys []K, vals []V, size int) error {
+	for size > 0 && len(keys) > 0 {
+		n := min(size, len(keys))
+		if _, err := m.BatchUpdate(keys[:n], vals[:n], nil); errors.Is(err, ebpf.ErrNotSupported) {
+			break
+		} else if err != nil {
+			return err
+		}
+		keys, vals = keys[n:], vals[n:]
+	}
+
+	for i := range keys {
+		if err := m.Put(keys[i], vals[i]); err != nil {
+			return err
+		}
+	}
+
+	return nil
+}
+
+// batchDelete removes the keys from the map in batches of up to size keys, and with one delete per key on kernels without batch operations,
+// keys which are not in the map are skipped
+func batchDelete[K any](m batchMap, keys []K, size int) error {
+	for size > 0 && len(keys) > 0 {
+		n, err := m.BatchDelete(keys[:min(size, len(keys))], nil)
+		if errors.Is(err, ebpf.ErrNotSupported) {
+			break
+		} else if errors.Is(err, os.ErrNotExist) {
+			// the batch stops at the first missing key
+			n++
+		} else if err != nil {
+			return err
+		}
+		keys = keys[n:]
+	}
+
+	for _, key := range keys {
+		if err := m.Delete(key); err != nil && !errors.Is(err, os.ErrNotExist) {
+			return err
+		}
+	}
+
+	return nil
+}
+
+// compactKey converts the Map Rule Identifier to the compact key used by the container map
+func (be *BPFEnforcer) compactKey(key InnerKey) RuleKey {
+	return RuleKey{Path: be.hashStr(key.Path[:]), Source: be.hashStr(key.Source[:])}
+}
+
+// FNV-1a parameters
+const (
+	fnvOffset64 uint64 = 0xcbf29ce484222325
+	fnvPrime64  uint64 = 0x100000001b3
+)
+
+// hashStr matches hash_str() in the BPF programs, a seeded FNV-1a over the bytes up to the first NUL
+func (be *BPFEnforcer) hashStr(b []byte) uint64 {
+	h := fnvOffset64 ^ be.hashSeed
+	for _, c := range b {
+		if c == 0 {
+			break
+		}
+		h ^= uint64(c)
+		h *= fnvPrime64
+	}
+	return h
 }
@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Authors of KubeArmor
+
+package bpflsm
+
+import (
+	"fmt"
+	"hash/fnv"
+	"os"
+	"strings"
+	"testing"
+
+	"github.com/cilium/ebpf"
+)
+
+func TestHashStr(t *testing.T) {
+	// without a seed hash_str() in the BPF programs is plain FNV-1a
+	be := &BPFEnforcer{}
+	for _, s := range []string{"", "a", "/usr/bin/bash", strings.Repeat("/x", 127)} {
+		ref := fnv.New64a()
+		ref.Write([]byte(s))
+
+		var key [256]byte
+		copy(key[:], s)
+		if got := be.hashStr(key[:]); got != ref.Sum64() {
+			t.Errorf("hashStr(%q) = %#x, want %#x", s, got, ref.Sum64())
+		}
+	}
+
+	// the seed only changes the offset basis, like FNV_OFFSET ^ hash_seed in the BPF programs
+	be.hashSeed = 0x5eed
+	if got, want := be.hashStr(nil), fnvOffset64^0x5eed; got != want {
+		t.Errorf("hash of the empty string = %#x, want %#x", got, want)
+	}
+
+	// the kernel stops at the first NUL
+	if be.hashStr([]byte("/bin/sh\x00garbage")) != be.hashStr([]byte("/bin/sh")) {
+		t.Errorf("hashStr hashed the bytes behind the NUL")
+	}
+}
+
+func TestCompactKey(t *testing.T) {
+	be := &BPFEnforcer{hashSeed: 42}
+
+	var key InnerKey
+	copy(key.Path[:], "/etc/passwd")
+	rk := be.compactKey(key)
+
+	if rk.Path != be.hashStr([]byte("/etc/passwd")) {
+		t.Errorf("path hash = %#x, want %#x", rk.Path, be.hashStr([]byte("/etc/passwd")))
+	}
+	// rules without fromSource are looked up with EMPTY_HASH
+	if rk.Source != fnvOffset64^42 {
+		t.Errorf("source hash of a rule without source = %#x, want %#x", rk.Source, fnvOffset64^42)
+	}
+
+	copy(key.Source[:], "/bin/cat")
+	if rk := be.compactKey(key); rk.Source != be.hashStr([]byte("/bin/cat")) {
+		t.Errorf("source hash = %#x, want %#x", rk.Source, be.hashStr([]byte("/bin/cat")))
+	}
+}
+
+func TestSourceHash(t *testing.T) {
+	be := &BPFEnforcer{hashSeed: 7}
+
+	if be.sourceHash("") != 0 {
+		t.Errorf("sourceHash of no source = %d, want 0", be.sourceHash(""))
+	}
+	if got, want := be.sourceHash("/bin/sh"), uint32(be.hashStr([]byte("/bin/sh"))); got != want {
+		t.Errorf("sourceHash = %#x, want %#x", got, want)
+	}
+
+	// kernel strings hold at most 255 characters
+	long := strings.Repeat("a", 300)
+	if got, want := be.sourceHash(long), uint32(be.hashStr([]byte(long[:255]))); got != want {
+		t.Errorf("sourceHash of a long source = %#x, want %#x", got, want)
+	}
+}
+
+func TestMaxContainers(t *testing.T) {
+	for _, tc := range []struct {
+		configured, podCapacity int
+		want                    uint32
+	}{
+		{0, 0, defaultMaxContainers},
+		// small nodes keep the default size
+		{0, 10, defaultMaxContainers},
+		{0, 110, 110*containersPerPod + 1},
+		{0, 250, 250*containersPerPod + 1},
+		// the configuration wins over the node capacity
+		{64, 250, 64},
+		{4096, 0, 4096},
+		{-1, 110, 110*containersPerPod + 1},
+	} {
+		if got := maxContainers(tc.configured, tc.podCapacity); got != tc.want {
+			t.Errorf("maxContainers(%d, %d) = %d, want %d", tc.configured, tc.podCapacity, got, tc.want)
+		}
+	}
+}
+
+// fakeMap records the operations of batchPut and batchDelete, batch operations fail like on kernels before 5.6 unless batch is set.
+// Missing keys fail with an error matching os.ErrNotExist like the ENOENT of *ebpf.Map
+type fakeMap struct {
+	batch   bool
+	entries map[uint32]uint32
+	batches []int
+	single  int
+}
+
+func (m *fakeMap) BatchUpdate(keys, values interface{}, _ *ebpf.BatchOptions) (int, error) {
+	if !m.batch {
+		return 0, ebpf.ErrNotSupported
+	}
+	ks, vs := keys.([]uint32), values.([]uint32)
+	m.batches = append(m.batches, len(ks))
+	for i := range ks {
+		m.entries[ks[i]] = vs[i]
+	}
+	return len(ks), nil
+}
+
+func (m *fakeMap) BatchDelete(keys interface{}, _ *ebpf.BatchOptions) (int, error) {
+	if !m.batch {
+		return 0, ebpf.ErrNotSupported
+	}
+	ks := keys.([]uint32)
+	m.batches = append(m.batches, len(ks))
+	for i, k := range ks {
+		// like the kernel the batch stops at the first missing key
+		if _, ok := m.entries[k]; !ok {
+			return i, os.ErrNotExist
+		}
+		delete(m.entries, k)
+	}
+	return len(ks), nil
+}
+
+func (m *fakeMap) Put(key, value interface{}) error {
+	m.single++
+	m.entries[key.(uint32)] = value.(uint32)
+	return nil
+}
+
+func (m *fakeMap) Delete(key interface{}) error {
+	m.single++
+	if _, ok := m.entries[key.(uint32)]; !ok {
+		return os.ErrNotExist
+	}
+	delete(m.entries, key.(uint32))
+	return nil
+}
+
+func TestBatchPut(t *testing.T) {
+	keys := []uint32{1, 2, 3, 4, 5, 6, 7}
+	vals := []uint32{10, 20, 30, 40, 50, 60, 70}
+
+	for _, tc := range []struct {
+		batch   bool
+		size    int
+		batches []int
+		single  int
+	}{
+		{true, 3, []int{3, 3, 1}, 0},
+		{true, 7, []int{7}, 0},
+		{true, 100, []int{7}, 0},
+		// no batch operations, one update per entry
+		{false, 3, nil, 7},
+		// a batch size of 0 disables the batch operations
+		{true, 0, nil, 7},
+	} {
+		m := &fakeMap{batch: tc.batch, entries: map[uint32]uint32{}}
+		if err := batchPut(m, keys, vals, tc.size); err != nil {
+			t.Errorf("batchPut (batch %t, size %d): %s", tc.batch, tc.size, err)
+			continue
+		}
+		if len(m.entries) != len(keys) {
+			t.Errorf("batchPut (batch %t, size %d) wrote %d of %d entries", tc.batch, tc.size, len(m.entries), len(keys))
+		}
+		for i, key := range keys {
+			if m.entries[key] != vals[i] {
+				t.Errorf("batchPut (batch %t, size %d): entry %d = %d, want %d", tc.batch, tc.size, key, m.entries[key], vals[i])
+			}
+		}
+		if fmt.Sprint(m.batches) != fmt.Sprint(tc.batches) || m.single != tc.single {
+			t.Errorf("batchPut (batch %t, size %d): batches %v and %d single updates, want %v and %d",
+				tc.batch, tc.size, m.batches, m.single, tc.batches, tc.single)
+		}
+	}
+}
+
+func TestBatchDelete(t *testing.T) {
+	for _, tc := range []struct {
+		batch   bool
+		size    int
+		keys    []uint32
+		batches []int
+		single  int
+	}{
+		{true, 2, []uint32{1, 2, 3}, []int{2, 1}, 0},
+		// missing keys are skipped, the batch goes on behind them
+		{true, 10, []uint32{1, 8, 2, 9, 3}, []int{5, 3, 1}, 0},
+		{false, 2, []uint32{1, 8, 2, 3}, nil, 4},
+		{true, 0, []uint32{1, 2, 3}, nil, 3},
+	} {
+		m := &fakeMap{batch: tc.batch, entries: map[uint32]uint32{1: 1, 2: 2, 3: 3, 4: 4}}
+		if err := batchDelete(m, tc.keys, tc.size); err != nil {
+			t.Errorf("batchDelete(%v, size %d): %s", tc.keys, tc.size, err)
+			continue
+		}
+		if len(m.entries) != 1 || m.entries[4] != 4 {
+			t.Errorf("batchDelete(%v, size %d) left %v, want only key 4", tc.keys, tc.size, m.entries)
+		}
+		if fmt.Sprint(m.batches) != fmt.Sprint(tc.batches) || m.single != tc.single {
+			t.Errorf("batchDelete(%v, size %d): batches %v and %d single deletes, want %v and %d",
+				tc.keys, tc.size, m.batches, m.single, tc.batches, tc.single)
+		}
+	}
+}
@@ -4,11 +4,15 @@
 package bpflsm
 
 import (
+	"encoding/binary"
 	"errors"
+	"fmt"
+	"net"
 	"os"
+	"sort"
+	"strconv"
 	"strings"
 
-	"github.com/cilium/ebpf"
 	mon "github.com/kubearmor/KubeArmor/KubeArmor/monitor"
 	tp "github.com/kubearmor/KubeArmor/KubeArmor/types"
 )
@@ -21,7 +25,7 @@ const (
 	OWNER     uint8 = 1 << 3
 	DIR       uint8 = 1 << 4
 	RECURSIVE uint8 = 1 << 5
-	HINT      uint8 = 1 << 6
+	VERIFY    uint8 = 1 << 6
 	DENY      uint8 = 1 << 7
 )
 
@@ -47,6 +51,30 @@ var (
 	CAPWHITELIST  = InnerKey{Path: [256]byte{104}}
 )
 
+// Bit Flags for Container Header
+const (
+	HasProcessRules      uint32 = 1 << 0
+	HasFileRules         uint32 = 1 << 1
+	HasNetworkRules      uint32 = 1 << 2
+	HasCapabilitiesRules uint32 = 1 << 3
+
+	// set when some rules of the class are qualified with fromSource
+	HasFromSourceProcessRules      uint32 = 1 << 4
+	HasFromSourceFileRules         uint32 = 1 << 5
+	HasFromSourceNetworkRules      uint32 = 1 << 6
+	HasFromSourceCapabilitiesRules uint32 = 1 << 7
+
+	HasAddressRules uint32 = 1 << 8
+)
+
+// Posture Index in Container Header
+const (
+	ProcPosture = 0
+	FilePosture = 1
+	NetPosture  = 2
+	CapPosture  = 3
+)
+
 // Protocol Identifiers for Network Rules
 var protocols = map[string]uint8{
 	"ICMP":   1,
@@ -65,21 +93,42 @@ const (
 	FAMILY   uint8 = 1
 	TYPE     uint8 = 2
 	PROTOCOL uint8 = 3
+	ADDRESS  uint8 = 4
 )
 
 // Key for mapping capabilities in bpf maps
 const capableKey = 200
 
+// Operations matched against the Address Rules
+const (
+	NetAddrConnect = 0
+	NetAddrBind    = 1
+)
+
+// Address families of the Address Rules
+const (
+	afInet  uint8 = 2
+	afInet6 uint8 = 10
+)
+
+// MaxNetPortRanges is the size of the port range table of an address prefix
+const MaxNetPortRanges = 8
+
 // RuleList Structure contains all the data required to set rules for a particular container
 type RuleList struct {
 	ProcessRuleList      map[InnerKey][2]uint8
 	FileRuleList         map[InnerKey][2]uint8
 	NetworkRuleList      map[InnerKey][2]uint8
 	CapabilitiesRuleList map[InnerKey][2]uint8
+	DirRuleList          map[DirKey][2]uint8
+	DirSources           map[uint32]string
+	AddrRuleList         map[NetAddrKey][]NetPortRange
+	VerifyKeys           map[InnerKey]bool
 	ProcWhiteListPosture bool
 	FileWhiteListPosture bool
 	NetWhiteListPosture  bool
 	CapWhiteListPosture  bool
+	AddrWhiteListPosture [2]bool
 }
 
 // Init prepares the RuleList object
@@ -95,6 +144,17 @@ func (r *RuleList) Init() {
 
 	r.CapabilitiesRuleList = make(map[InnerKey][2]uint8)
 	r.CapWhiteListPosture = false
+
+	r.DirRuleList = make(map[DirKey][2]uint8)
+	r.DirSources = make(map[uint32]string)
+	r.AddrRuleList = make(map[NetAddrKey][]NetPortRange)
+	r.AddrWhiteListPosture = [2]bool{}
+	r.VerifyKeys = make(map[InnerKey]bool)
+}
+
+// Empty checks if the RuleList has no rules at all
+func (r *RuleList) Empty() bool {
+	return len(r.FileRuleList) == 0 && len(r.ProcessRuleList) == 0 && len(r.NetworkRuleList) == 0 && len(r.CapabilitiesRuleList) == 0 && len(r.AddrRuleList) == 0
 }
 
 // UpdateContainerRules updates individual container map with new rules and resolves conflicting rules
@@ -159,21 +219,21 @@ func (be *BPFEnforcer) UpdateContainerRules(id string, securityPolicies []tp.Sec
 			if len(dir.FromSource) == 0 {
 				if dir.Action == "Allow" {
 					newrules.ProcWhiteListPosture = true
-					dirtoMap(PROCESS, dir.Directory, "", newrules.ProcessRuleList, val)
+					be.dirtoMap(PROCESS, dir.Directory, "", newrules.ProcessRuleList, newrules.DirRuleList, newrules.DirSources, val)
 
 				} else if dir.Action == "Block" {
 					val[PROCESS] = val[PROCESS] | DENY
-					dirtoMap(PROCESS, dir.Directory, "", newrules.ProcessRuleList, val)
+					be.dirtoMap(PROCESS, dir.Directory, "", newrules.ProcessRuleList, newrules.DirRuleList, newrules.DirSources, val)
 				}
 			} else {
 				for _, src := range dir.FromSource {
 					if dir.Action == "Allow" {
 						newrules.ProcWhiteListPosture = true
-						dirtoMap(PROCESS, dir.Directory, src.Path, newrules.ProcessRuleList, val)
+						be.dirtoMap(PROCESS, dir.Directory, src.Path, newrules.ProcessRuleList, newrules.DirRuleList, newrules.DirSources, val)
 
 					} else if dir.Action == "Block" {
 						val[PROCESS] = val[PROCESS] | DENY
-						dirtoMap(PROCESS, dir.Directory, src.Path, newrules.ProcessRuleList, val)
+						be.dirtoMap(PROCESS, dir.Directory, src.Path, newrules.ProcessRuleList, newrules.DirRuleList, newrules.DirSources, val)
 					}
 				}
 			}
@@ -231,21 +291,21 @@ func (be *BPFEnforcer) UpdateContainerRules(id string, securityPolicies []tp.Sec
 			if len(dir.FromSource) == 0 {
 				if dir.Action == "Allow" {
 					newrules.FileWhiteListPosture = true
-					dirtoMap(FILE, dir.Directory, "", newrules.FileRuleList, val)
+					be.dirtoMap(FILE, dir.Directory, "", newrules.FileRuleList, newrules.DirRuleList, newrules.DirSources, val)
 
 				} else if dir.Action == "Block" {
 					val[FILE] = val[FILE] | DENY
-					dirtoMap(FILE, dir.Directory, "", newrules.FileRuleList, val)
+					be.dirtoMap(FILE, dir.Directory, "", newrules.FileRuleList, newrules.DirRuleList, newrules.DirSources, val)
 				}
 			} else {
 				for _, src := range dir.FromSource {
 					if dir.Action == "Allow" {
 						newrules.FileWhiteListPosture = true
-						dirtoMap(FILE, dir.Directory, src.Path, newrules.FileRuleList, val)
+						be.dirtoMap(FILE, dir.Directory, src.Path, newrules.FileRuleList, newrules.DirRuleList, newrules.DirSources, val)
 
 					} else if dir.Action == "Block" {
 						val[FILE] = val[FILE] | DENY
-						dirtoMap(FILE, dir.Directory, src.Path, newrules.FileRuleList, val)
+						be.dirtoMap(FILE, dir.Directory, src.Path, newrules.FileRuleList, newrules.DirRuleList, newrules.DirSources, val)
 					}
 				}
 			}
@@ -288,6 +348,29 @@ func (be *BPFEnforcer) UpdateContainerRules(id string, securityPolicies []tp.Sec
 				}
 			}
 		}
+		for _, addr := range secPolicy.Spec.Network.MatchAddresses {
+			key, err := newNetAddrKey(addr.CIDR, addr.Bind)
+			if err != nil {
+				be.Logger.Warnf("Skipping address rule %q: %s", addr.CIDR, err)
+				continue
+			}
+			lo, hi, err := portRange(addr.Ports)
+			if err != nil {
+				be.Logger.Warnf("Skipping address rule %q: %s", addr.CIDR, err)
+				continue
+			}
+
+			var val [2]uint8
+			if addr.Action == "Allow" {
+				newrules.AddrWhiteListPosture[key.Op] = true
+			} else if addr.Action == "Block" {
+				val[NETWORK] = val[NETWORK] | DENY
+			} else {
+				continue
+			}
+			newrules.AddrRuleList[key] = append(newrules.AddrRuleList[key], NetPortRange{Lo: lo, Hi: hi, Rule: val})
+		}
+
 		for _, capab := range secPolicy.Spec.Capabilities.MatchCapabilities {
 			var val [2]uint8
 			var key = InnerKey{Path: [256]byte{}, Source: [256]byte{}}
@@ -341,22 +424,43 @@ func (be *BPFEnforcer) UpdateContainerRules(id string, securityPolicies []tp.Sec
 		return
 	}
 
-	if be.ContainerMap[id].Map == nil && !(len(newrules.FileRuleList) == 0 && len(newrules.ProcessRuleList) == 0 && len(newrules.NetworkRuleList) == 0 && len(newrules.CapabilitiesRuleList) == 0) {
+	if be.AtomicRuleSwap && !newrules.Empty() {
+		be.swapContainerRules(id, newrules, defaultPosture)
+		return
+	}
+
+	if be.ContainerMap[id].Map == nil && !newrules.Empty() {
 		// We create the inner map only when we have policies specific to that
 		be.Logger.Printf("Creating inner map for %s", id)
 		be.CreateContainerInnerMap(id)
-	} else if len(newrules.FileRuleList) == 0 && len(newrules.ProcessRuleList) == 0 && len(newrules.NetworkRuleList) == 0 && len(newrules.CapabilitiesRuleList) == 0 {
+	} else if newrules.Empty() {
 		// All Policies removed for the container
 		be.Logger.Printf("Deleting inner map for %s", id)
 		be.DeleteContainerInnerMap(id)
 		return
 	}
 
+	if be.CompactKeys {
+		postures := map[InnerKey][2]uint8{PROCWHITELIST: {}, FILEWHITELIST: {}, NETWHITELIST: {}, CAPWHITELIST: {}}
+		be.deleteVerifyKeys(id, be.updateVerifyKeys(id, postures, newrules.ProcessRuleList, newrules.FileRuleList, newrules.NetworkRuleList, newrules.CapabilitiesRuleList))
+	}
+
 	// Check for differences in Fresh Rules Set and Existing Ruleset
-	be.resolveConflicts(newrules.ProcWhiteListPosture, be.ContainerMap[id].Rules.ProcWhiteListPosture, newrules.ProcessRuleList, be.ContainerMap[id].Rules.ProcessRuleList, be.ContainerMap[id].Map)
-	be.resolveConflicts(newrules.FileWhiteListPosture, be.ContainerMap[id].Rules.FileWhiteListPosture, newrules.FileRuleList, be.ContainerMap[id].Rules.FileRuleList, be.ContainerMap[id].Map)
-	be.resolveConflicts(newrules.NetWhiteListPosture, be.ContainerMap[id].Rules.NetWhiteListPosture, newrules.NetworkRuleList, be.ContainerMap[id].Rules.NetworkRuleList, be.ContainerMap[id].Map)
-	be.resolveConflicts(newrules.CapWhiteListPosture, be.ContainerMap[id].Rules.CapWhiteListPosture, newrules.CapabilitiesRuleList, be.ContainerMap[id].Rules.CapabilitiesRuleList, be.ContainerMap[id].Map)
+	stale := []InnerKey{}
+	stale = append(stale, resolveConflicts(newrules.ProcessRuleList, be.ContainerMap[id].Rules.ProcessRuleList)...)
+	stale = append(stale, resolveConflicts(newrules.FileRuleList, be.ContainerMap[id].Rules.FileRuleList)...)
+	stale = append(stale, resolveConflicts(newrules.NetworkRuleList, be.ContainerMap[id].Rules.NetworkRuleList)...)
+	stale = append(stale, resolveConflicts(newrules.CapabilitiesRuleList, be.ContainerMap[id].Rules.CapabilitiesRuleList)...)
+
+	rules := ruleSet(newrules, defaultPosture)
+	for _, key := range []InnerKey{PROCWHITELIST, FILEWHITELIST, NETWHITELIST, CAPWHITELIST} {
+		if _, ok := rules[key]; !ok {
+			stale = append(stale, key)
+		}
+	}
+	if err := be.deleteRules(id, stale); err != nil {
+		be.Logger.Errf("error deleting rules from map for container %s: %s", id, err)
+	}
 
 	// Update Posture
 	if list, ok := be.ContainerMap[id]; ok {
@@ -368,101 +472,222 @@ func (be *BPFEnforcer) UpdateContainerRules(id string, securityPolicies []tp.Sec
 		be.ContainerMap[id] = list
 	}
 
-	if newrules.ProcWhiteListPosture {
-		if defaultPosture.FileAction == "block" {
-			if err := be.ContainerMap[id].Map.Put(PROCWHITELIST, [2]uint8{BlockPosture}); err != nil {
-				be.Logger.Errf("error adding proc whitelist key rule to map for container %s: %s", id, err)
-			}
-		} else {
-			if err := be.ContainerMap[id].Map.Put(PROCWHITELIST, [2]uint8{AuditPosture}); err != nil {
-				be.Logger.Errf("error adding proc whitelist key rule to map for container %s: %s", id, err)
-			}
-		}
-
-	} else {
-		if err := be.ContainerMap[id].Map.Delete(PROCWHITELIST); err != nil {
-			if !errors.Is(err, os.ErrNotExist) {
-				be.Logger.Err(err.Error())
-			}
-		}
-	}
 	for key, val := range newrules.ProcessRuleList {
 		be.ContainerMap[id].Rules.ProcessRuleList[key] = val
-		if err := be.ContainerMap[id].Map.Put(key, val); err != nil {
-			be.Logger.Errf("error adding rule to map for container %s: %s", id, err)
-		}
-	}
-
-	if newrules.FileWhiteListPosture {
-		if defaultPosture.FileAction == "block" {
-			if err := be.ContainerMap[id].Map.Put(FILEWHITELIST, [2]uint8{BlockPosture}); err != nil {
-				be.Logger.Errf("error adding file whitelist key rule to map for container %s: %s", id, err)
-			}
-		} else {
-			if err := be.ContainerMap[id].Map.Put(FILEWHITELIST, [2]uint8{AuditPosture}); err != nil {
-				be.Logger.Errf("error adding file whitelist key rule to map for container %s: %s", id, err)
-			}
-		}
-	} else {
-		if err := be.ContainerMap[id].Map.Delete(FILEWHITELIST); err != nil {
-			if !errors.Is(err, os.ErrNotExist) {
-				be.Logger.Err(err.Error())
-			}
-		}
 	}
 	for key, val := range newrules.FileRuleList {
 		be.ContainerMap[id].Rules.FileRuleList[key] = val
-		if err := be.ContainerMap[id].Map.Put(key, val); err != nil {
-			be.Logger.Errf("error adding rule to map for container %s: %s", id, err)
-		}
+	}
+	for key, val := range newrules.NetworkRuleList {
+		be.ContainerMap[id].Rules.NetworkRuleList[key] = val
+	}
+	for key, val := range newrules.CapabilitiesRuleList {
+		be.ContainerMap[id].Rules.CapabilitiesRuleList[key] = val
+	}
+	if err := be.putRules(be.ContainerMap[id], be.ContainerMap[id].Map, rules); err != nil {
+		be.Logger.Errf("error adding rules to map for container %s: %s", id, err)
 	}
 
-	if newrules.NetWhiteListPosture {
-		if defaultPosture.NetworkAction == "block" {
-			if err := be.ContainerMap[id].Map.Put(NETWHITELIST, [2]uint8{BlockPosture}); err != nil {
-				be.Logger.Errf("error adding network key rule to map for container %s: %s", id, err)
-			}
-		} else {
-			if err := be.ContainerMap[id].Map.Put(NETWHITELIST, [2]uint8{AuditPosture}); err != nil {
-				be.Logger.Errf("error adding network key rule to map for container %s: %s", id, err)
-			}
+	staleDirs := resolveDirConflicts(newrules.DirRuleList, be.ContainerMap[id].Rules.DirRuleList)
+	if err := batchDelete(be.ContainerMap[id].DirMap, staleDirs, be.mapBatchSize); err != nil {
+		be.Logger.Errf("error deleting directory rules from map for container %s: %s", id, err)
+	}
+	dirKeys := []DirKey{}
+	dirVals := []DirValue{}
+	for key, val := range dirRuleValues(newrules.DirRuleList, newrules.DirSources) {
+		be.ContainerMap[id].Rules.DirRuleList[key] = newrules.DirRuleList[key]
+		dirKeys = append(dirKeys, key)
+		dirVals = append(dirVals, val)
+	}
+	if err := batchPut(be.ContainerMap[id].DirMap, dirKeys, dirVals, be.mapBatchSize); err != nil {
+		be.Logger.Errf("error adding directory rules to map for container %s: %s", id, err)
+	}
+
+	staleAddrs := []NetAddrKey{}
+	for key := range be.ContainerMap[id].Rules.AddrRuleList {
+		if _, ok := newrules.AddrRuleList[key]; !ok {
+			staleAddrs = append(staleAddrs, key)
 		}
-	} else {
-		if err := be.ContainerMap[id].Map.Delete(NETWHITELIST); err != nil {
-			if !errors.Is(err, os.ErrNotExist) {
-				be.Logger.Err(err.Error())
+	}
+	if err := batchDelete(be.ContainerMap[id].NetMap, staleAddrs, be.mapBatchSize); err != nil {
+		be.Logger.Errf("error deleting address rules from map for container %s: %s", id, err)
+	}
+	if err := putMap(be.ContainerMap[id].NetMap, be.addrRuleValues(id, newrules.AddrRuleList), be.mapBatchSize); err != nil {
+		be.Logger.Errf("error adding address rules to map for container %s: %s", id, err)
+	}
+	if list, ok := be.ContainerMap[id]; ok {
+		list.Rules.AddrRuleList = newrules.AddrRuleList
+		list.Rules.AddrWhiteListPosture = newrules.AddrWhiteListPosture
+		be.ContainerMap[id] = list
+	}
+
+	be.publishHeader(id, newrules, defaultPosture)
+}
+
+// swapContainerRules replaces the rule maps of the container with new ones holding the fresh rule set
+func (be *BPFEnforcer) swapContainerRules(id string, newrules RuleList, defaultPosture tp.DefaultPosture) {
+	var stale []InnerKey
+	if be.CompactKeys {
+		postures := map[InnerKey][2]uint8{PROCWHITELIST: {}, FILEWHITELIST: {}, NETWHITELIST: {}, CAPWHITELIST: {}}
+		stale = be.updateVerifyKeys(id, postures, newrules.ProcessRuleList, newrules.FileRuleList, newrules.NetworkRuleList, newrules.CapabilitiesRuleList)
+	}
+
+	rules := ruleSet(newrules, defaultPosture)
+
+	// The header goes in ahead of the maps. It keeps the classes of the previous rules checked and their policy
+	// generation until the swap is done, the generation is only bumped once both the header and the maps are visible
+	key := be.ContainerMap[id].Key
+	var prev ContainerHeader
+	hasPrev := be.ContainerHdrMap.Lookup(key, &prev) == nil
+	staged := containerHeader(newrules, defaultPosture, prev.PolicyGen)
+	staged.Flags |= prev.Flags
+	if err := be.putContainer(be.ContainerHdrMap, key, staged); err != nil {
+		be.Logger.Errf("error updating header for container %s: %s", id, err)
+	}
+
+	if err := be.swapContainerMaps(id, rules, dirRuleValues(newrules.DirRuleList, newrules.DirSources), be.addrRuleValues(id, newrules.AddrRuleList)); err != nil {
+		be.Logger.Errf("error swapping rule maps of container %s: %s", id, err)
+		if hasPrev {
+			if err := be.ContainerHdrMap.Put(key, prev); err != nil {
+				be.Logger.Errf("error restoring header for container %s: %s", id, err)
 			}
+		} else if err := be.ContainerHdrMap.Delete(key); err != nil && !errors.Is(err, os.ErrNotExist) {
+			be.Logger.Errf("error deleting header for container %s: %s", id, err)
 		}
+		return
 	}
-	for key, val := range newrules.NetworkRuleList {
-		be.ContainerMap[id].Rules.NetworkRuleList[key] = val
-		if err := be.ContainerMap[id].Map.Put(key, val); err != nil {
-			be.Logger.Errf("error adding rule to map for container %s: %s", id, err)
+
+	// Rules only referenced by the previous maps can go now
+	be.deleteVerifyKeys(id, stale)
+
+	ckv := be.ContainerMap[id]
+	newrules.VerifyKeys = ckv.Rules.VerifyKeys
+	ckv.Rules = newrules
+	be.ContainerMap[id] = ckv
+
+	be.publishHeader(id, newrules, defaultPosture)
+}
+
+// ruleSet returns the complete content of the container map for a rule set, including the whitelist posture keys
+func ruleSet(newrules RuleList, defaultPosture tp.DefaultPosture) map[InnerKey][2]uint8 {
+	rules := make(map[InnerKey][2]uint8)
+	for _, list := range []map[InnerKey][2]uint8{newrules.ProcessRuleList, newrules.FileRuleList, newrules.NetworkRuleList, newrules.CapabilitiesRuleList} {
+		for key, val := range list {
+			rules[key] = val
 		}
 	}
+	if newrules.ProcWhiteListPosture {
+		rules[PROCWHITELIST] = [2]uint8{posture(true, defaultPosture.FileAction)}
+	}
+	if newrules.FileWhiteListPosture {
+		rules[FILEWHITELIST] = [2]uint8{posture(true, defaultPosture.FileAction)}
+	}
+	if newrules.NetWhiteListPosture {
+		rules[NETWHITELIST] = [2]uint8{posture(true, defaultPosture.NetworkAction)}
+	}
 	if newrules.CapWhiteListPosture {
-		if defaultPosture.CapabilitiesAction == "block" {
-			if err := be.ContainerMap[id].Map.Put(CAPWHITELIST, [2]uint8{BlockPosture}); err != nil {
-				be.Logger.Errf("error adding network key rule to map for container %s: %s", id, err)
-			}
+		rules[CAPWHITELIST] = [2]uint8{posture(true, defaultPosture.CapabilitiesAction)}
+	}
+	return rules
+}
+
+// publishHeader publishes the header once all rules are in place, the new policy generation drops verdicts cached for the previous rules
+func (be *BPFEnforcer) publishHeader(id string, newrules RuleList, defaultPosture tp.DefaultPosture) {
+	be.policyGen++
+	if err := be.putContainer(be.ContainerHdrMap, be.ContainerMap[id].Key, containerHeader(newrules, defaultPosture, be.policyGen)); err != nil {
+		be.Logger.Errf("error updating header for container %s: %s", id, err)
+	}
+}
+
+// containerHeader summarises the rule classes and postures of a rule set
+func containerHeader(rules RuleList, defaultPosture tp.DefaultPosture, gen uint32) ContainerHeader {
+	hdr := ContainerHeader{PolicyGen: gen}
+
+	if len(rules.ProcessRuleList) > 0 {
+		hdr.Flags |= HasProcessRules
+	}
+	if len(rules.FileRuleList) > 0 {
+		hdr.Flags |= HasFileRules
+	}
+	if len(rules.NetworkRuleList) > 0 {
+		hdr.Flags |= HasNetworkRules
+	}
+	if len(rules.CapabilitiesRuleList) > 0 {
+		hdr.Flags |= HasCapabilitiesRules
+	}
+
+	if len(rules.AddrRuleList) > 0 {
+		hdr.Flags |= HasAddressRules
+	}
+
+	// capability rules without fromSource are matched with the bitmasks alone
+	for key, val := range rules.CapabilitiesRuleList {
+		if key.Source[0] != 0 || key.Path[1] >= 64 {
+			continue
+		}
+		if val[CAPABILITIES]&DENY != 0 {
+			hdr.CapDeny |= 1 << key.Path[1]
 		} else {
-			if err := be.ContainerMap[id].Map.Put(CAPWHITELIST, [2]uint8{AuditPosture}); err != nil {
-				be.Logger.Errf("error adding network key rule to map for container %s: %s", id, err)
-			}
+			hdr.CapAllow |= 1 << key.Path[1]
 		}
-	} else {
-		if err := be.ContainerMap[id].Map.Delete(CAPWHITELIST); err != nil {
-			if !errors.Is(err, os.ErrNotExist) {
-				be.Logger.Err(err.Error())
-			}
+	}
+
+	if hasFromSource(rules.ProcessRuleList) {
+		hdr.Flags |= HasFromSourceProcessRules
+	}
+	if hasFromSource(rules.FileRuleList) {
+		hdr.Flags |= HasFromSourceFileRules
+	}
+	if hasFromSource(rules.NetworkRuleList) {
+		hdr.Flags |= HasFromSourceNetworkRules
+	}
+	if hasFromSource(rules.CapabilitiesRuleList) {
+		hdr.Flags |= HasFromSourceCapabilitiesRules
+	}
+
+	// directory rules are matched by both the process and the file hooks
+	for key, val := range rules.DirRuleList {
+		if key.Source == 0 {
+			continue
+		}
+		if val[PROCESS] != 0 {
+			hdr.Flags |= HasFromSourceProcessRules
+		}
+		if val[FILE] != 0 {
+			hdr.Flags |= HasFromSourceFileRules
 		}
 	}
-	for key, val := range newrules.CapabilitiesRuleList {
-		be.ContainerMap[id].Rules.CapabilitiesRuleList[key] = val
-		if err := be.ContainerMap[id].Map.Put(key, val); err != nil {
-			be.Logger.Errf("error adding rule to map for container %s: %s", id, err)
+
+	// process posture follows the file posture like the process whitelist key
+	hdr.Posture[ProcPosture] = posture(rules.ProcWhiteListPosture, defaultPosture.FileAction)
+	hdr.Posture[FilePosture] = posture(rules.FileWhiteListPosture, defaultPosture.FileAction)
+	hdr.Posture[NetPosture] = posture(rules.NetWhiteListPosture, defaultPosture.NetworkAction)
+	hdr.Posture[CapPosture] = posture(rules.CapWhiteListPosture, defaultPosture.CapabilitiesAction)
+	hdr.AddrPosture[NetAddrConnect] = posture(rules.AddrWhiteListPosture[NetAddrConnect], defaultPosture.NetworkAction)
+	hdr.AddrPosture[NetAddrBind] = posture(rules.AddrWhiteListPosture[NetAddrBind], defaultPosture.NetworkAction)
+
+	return hdr
+}
+
+// hasFromSource checks if any key of a rule list is qualified with fromSource
+func hasFromSource(list map[InnerKey][2]uint8) bool {
+	for key := range list {
+		if key.Source[0] != 0 {
+			return true
 		}
 	}
+	return false
+}
+
+// posture returns the value of a class posture, 0 if the class has no allow rules
+func posture(whitelist bool, action string) uint8 {
+	if !whitelist {
+		return 0
+	}
+	if action == "block" {
+		return BlockPosture
+	}
+	return AuditPosture
 }
 
 func fuseProcAndFileRules(procList, fileList map[InnerKey][2]uint8) {
@@ -474,23 +699,46 @@ func fuseProcAndFileRules(procList, fileList map[InnerKey][2]uint8) {
 	}
 }
 
-func (be *BPFEnforcer) resolveConflicts(newPosture, oldPosture bool, newRuleList, oldRuleList map[InnerKey][2]uint8, cmap *ebpf.Map) {
-	// We delete existing elements which are not in the fresh rule set
+// resolveConflicts returns the keys of the existing rule set which are not in the fresh rule set and drops them from the existing one
+func resolveConflicts(newRuleList, oldRuleList map[InnerKey][2]uint8) []InnerKey {
+	stale := []InnerKey{}
 	for key := range oldRuleList {
 		if _, ok := newRuleList[key]; !ok {
-			// Delete Element from Container Map
-			if err := cmap.Delete(key); err != nil {
-				if !errors.Is(err, os.ErrNotExist) {
-					be.Logger.Err(err.Error())
-				}
-			}
+			stale = append(stale, key)
+			delete(oldRuleList, key)
+		}
+	}
+	return stale
+}
+
+// resolveDirConflicts returns the keys of the existing directory rules which are not in the fresh rule set and drops them from the existing one
+func resolveDirConflicts(newRuleList, oldRuleList map[DirKey][2]uint8) []DirKey {
+	stale := []DirKey{}
+	for key := range oldRuleList {
+		if _, ok := newRuleList[key]; !ok {
+			stale = append(stale, key)
 			delete(oldRuleList, key)
 		}
 	}
+	return stale
 }
 
-// dirtoMap extracts parent directories from the Path Key and adds it as hints in the Container Rule Map
-func dirtoMap(idx int, p, src string, m map[InnerKey][2]uint8, val [2]uint8) {
+// dirtoMap adds the directory itself to the Container Rule Map and the directory prefix to the Directory Rule List
+func (be *BPFEnforcer) dirtoMap(idx int, p, src string, m map[InnerKey][2]uint8, dirs map[DirKey][2]uint8, sources map[uint32]string, val [2]uint8) {
+	dkey, err := newDirKey(p, be.sourceHash(src))
+	if err != nil {
+		be.Logger.Warnf("Skipping directory rule %q: %s", p, err)
+		return
+	}
+
+	// the kernel tells fromSource rules apart by the hash of the source and checks the path on a match
+	if other, ok := sources[dkey.Source]; ok && other != src {
+		be.Logger.Warnf("Skipping directory rule %q: source %q has the same hash as %q", p, src, other)
+		return
+	} else if src != "" {
+		sources[dkey.Source] = src
+	}
+
 	var key InnerKey
 	if src != "" {
 		copy(key.Source[:], []byte(src))
@@ -503,31 +751,197 @@ func dirtoMap(idx int, p, src string, m map[InnerKey][2]uint8, val [2]uint8) {
 	key.Path = pth
 	m[key] = val
 
-	// Add directory for sub file matching
-	copy(key.Path[:], []byte(p))
+	// Add directory for sub file matching, process and file rules on the same directory share the entry
+	dval := dirs[dkey]
+	dval[idx] = val[idx] | DIR
+	dirs[dkey] = dval
+}
 
-	val[idx] = val[idx] | DIR
-	if oldval, ok := m[key]; ok {
-		if oldval[idx]&HINT != 0 {
-			val[idx] = val[idx] | HINT
+// dirRuleValues resolves for every directory rule the rule inherited from its closest recursive parent directory,
+// the kernel falls back to it when the longest matching directory rule does not apply to a path
+func dirRuleValues(dirs map[DirKey][2]uint8, sources map[uint32]string) map[DirKey]DirValue {
+	vals := make(map[DirKey]DirValue, len(dirs))
+
+	for key, rule := range dirs {
+		dir := key.Dir()
+		val := DirValue{Self: rule, Len: uint16(len(dir))}
+		copy(val.Source[:len(val.Source)-1], sources[key.Source])
+
+		for _, idx := range []int{PROCESS, FILE} {
+			for parent := parentDir(dir); parent != ""; parent = parentDir(parent) {
+				// parents are shorter than the directory, so their keys are valid as well
+				pkey, _ := newDirKey(parent, key.Source)
+				if prule, ok := dirs[pkey]; ok && prule[idx]&RECURSIVE != 0 {
+					val.Inherit[idx] = prule[idx]
+					break
+				}
+			}
 		}
+
+		vals[key] = val
 	}
-	m[key] = val
 
-	for i := 1; i < len(paths)-1; i++ {
-		var key InnerKey
-		val[idx] = val[idx] & ^DIR // reset DIR mask to false
-		val[idx] = val[idx] | HINT
-		var hint = strings.Join(paths[0:i], "/") + "/"
-		copy(key.Path[:], []byte(hint))
-		if src != "" {
-			copy(key.Source[:], []byte(src))
+	return vals
+}
+
+// newDirKey creates the LPM Trie key for a directory, directories longer than the key are rejected rather than truncated
+// as a truncated prefix would match paths outside of the directory
+func newDirKey(dir string, source uint32) (DirKey, error) {
+	var key DirKey
+	if len(dir) > len(key.Path)-1 {
+		return key, fmt.Errorf("directory is longer than %d characters", len(key.Path)-1)
+	}
+	n := copy(key.Path[:len(key.Path)-1], dir)
+	key.Source = source
+	key.PrefixLen = uint32(binary.Size(key.Source)+n) * 8
+	return key, nil
+}
+
+// Dir returns the directory prefix of the key
+func (key DirKey) Dir() string {
+	return string(key.Path[:int(key.PrefixLen/8)-binary.Size(key.Source)])
+}
+
+// parentDir returns the parent of a directory ending with "/", or "" for the root directory
+func parentDir(dir string) string {
+	i := strings.LastIndex(strings.TrimSuffix(dir, "/"), "/")
+	if i < 0 {
+		return ""
+	}
+	return dir[:i+1]
+}
+
+// sourceHash matches the source identifier generated by hash_str() in the BPF programs, 0 stands for no source
+func (be *BPFEnforcer) sourceHash(src string) uint32 {
+	if src == "" {
+		return 0
+	}
+	// kernel strings hold at most 255 characters
+	var s [255]byte
+	copy(s[:], src)
+	return uint32(be.hashStr(s[:]))
+}
+
+// newNetAddrKey converts the CIDR of an address rule to its key in the Address Rule LPM Trie, a plain address matches only itself.
+// The BPF programs match IPv4-mapped IPv6 addresses with the IPv4 rules, so CIDRs within ::ffff:0:0/96 become IPv4 keys
+func newNetAddrKey(cidr string, bind bool) (NetAddrKey, error) {
+	var key NetAddrKey
+
+	if !strings.Contains(cidr, "/") {
+		if strings.Contains(cidr, ":") {
+			cidr = cidr + "/128"
+		} else {
+			cidr = cidr + "/32"
 		}
-		if oldval, ok := m[key]; ok {
-			if oldval[idx]&DIR != 0 {
-				val[idx] = oldval[idx] | HINT
+	}
+
+	_, ipnet, err := net.ParseCIDR(cidr)
+	if err != nil {
+		return key, err
+	}
+
+	ones, _ := ipnet.Mask.Size()
+	if len(ipnet.Mask) == net.IPv4len {
+		key.Family = afInet
+		copy(key.Addr[:], ipnet.IP.To4())
+	} else if ip := ipnet.IP.To4(); ip != nil && ones >= 96 {
+		key.Family = afInet
+		copy(key.Addr[:], ip)
+		ones -= 96
+	} else {
+		key.Family = afInet6
+		copy(key.Addr[:], ipnet.IP.To16())
+	}
+
+	key.Op = NetAddrConnect
+	if bind {
+		key.Op = NetAddrBind
+	}
+
+	// the operation and the family are always part of the prefix
+	key.PrefixLen = uint32(16 + ones)
+
+	return key, nil
+}
+
+// portRange parses the ports of an address rule, either a port or a range of ports, no ports match every port
+func portRange(ports string) (uint16, uint16, error) {
+	if ports == "" {
+		return 0, 65535, nil
+	}
+
+	first, last, isRange := strings.Cut(ports, "-")
+	lo, err := strconv.ParseUint(first, 10, 16)
+	if err != nil {
+		return 0, 0, err
+	}
+	if !isRange {
+		return uint16(lo), uint16(lo), nil
+	}
+
+	hi, err := strconv.ParseUint(last, 10, 16)
+	if err != nil {
+		return 0, 0, err
+	}
+	if hi < lo {
+		return 0, 0, fmt.Errorf("invalid port range %s", ports)
+	}
+	return uint16(lo), uint16(hi), nil
+}
+
+// addrRuleValues builds the port range tables of the address prefixes, the LPM lookup only returns the longest matching
+// prefix so the ranges of the enclosing prefixes follow the ones of the prefix itself
+func (be *BPFEnforcer) addrRuleValues(id string, addrs map[NetAddrKey][]NetPortRange) map[NetAddrKey]NetAddrValue {
+	keys := make([]NetAddrKey, 0, len(addrs))
+	for key := range addrs {
+		keys = append(keys, key)
+	}
+	sort.Slice(keys, func(i, j int) bool { return keys[i].PrefixLen > keys[j].PrefixLen })
+
+	vals := make(map[NetAddrKey]NetAddrValue, len(addrs))
+
+	for _, key := range keys {
+		var val NetAddrValue
+
+		ranges := []NetPortRange{}
+		for _, parent := range keys {
+			if parent.PrefixLen <= key.PrefixLen && containsPrefix(parent, key) {
+				own := append([]NetPortRange{}, addrs[parent]...)
+				// blocked ranges go first when the rules of a prefix overlap
+				sort.SliceStable(own, func(i, j int) bool { return own[i].Rule[NETWORK]&DENY > own[j].Rule[NETWORK]&DENY })
+				ranges = append(ranges, own...)
 			}
 		}
-		m[key] = val
+
+		if len(ranges) > MaxNetPortRanges {
+			be.Logger.Warnf("Address rules of %s for %s have %d port ranges, only the first %d are enforced", id, net.IP(key.Addr[:]), len(ranges), MaxNetPortRanges)
+			ranges = ranges[:MaxNetPortRanges]
+		}
+
+		val.Count = uint32(copy(val.Ports[:], ranges))
+		vals[key] = val
+	}
+
+	return vals
+}
+
+// containsPrefix checks if the prefix of outer covers the one of inner
+func containsPrefix(outer, inner NetAddrKey) bool {
+	if outer.Op != inner.Op || outer.Family != inner.Family {
+		return false
+	}
+
+	bits := int(outer.PrefixLen) - 16
+	for i := 0; i < bits/8; i++ {
+		if outer.Addr[i] != inner.Addr[i] {
+			return false
+		}
+	}
+	if rem := bits % 8; rem != 0 {
+		mask := byte(0xff << (8 - rem))
+		if outer.Addr[bits/8]&mask != inner.Addr[bits/8]&mask {
+			return false
+		}
 	}
+	return true
 }
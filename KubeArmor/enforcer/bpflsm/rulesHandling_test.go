@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Authors of KubeArmor
+
+package bpflsm
+
+import (
+	"net"
+	"strings"
+	"testing"
+)
+
+func dirKey(t *testing.T, dir string, source uint32) DirKey {
+	t.Helper()
+	key, err := newDirKey(dir, source)
+	if err != nil {
+		t.Fatalf("newDirKey(%q): %s", dir, err)
+	}
+	return key
+}
+
+func TestNewDirKey(t *testing.T) {
+	key := dirKey(t, "/etc/ssl/", 7)
+	if key.Source != 7 {
+		t.Errorf("source = %d, want 7", key.Source)
+	}
+	// source hash followed by the directory prefix
+	if key.PrefixLen != (4+9)*8 {
+		t.Errorf("prefix length = %d, want %d", key.PrefixLen, (4+9)*8)
+	}
+	if dir := key.Dir(); dir != "/etc/ssl/" {
+		t.Errorf("Dir() = %q, want %q", dir, "/etc/ssl/")
+	}
+
+	longest := "/" + strings.Repeat("a", 249) + "/"
+	if key := dirKey(t, longest, 0); key.Dir() != longest {
+		t.Errorf("Dir() = %q, want %q", key.Dir(), longest)
+	}
+
+	if _, err := newDirKey(longest+"b/", 0); err == nil {
+		t.Errorf("newDirKey accepted a directory of %d characters", len(longest)+2)
+	}
+}
+
+func TestParentDir(t *testing.T) {
+	for dir, parent := range map[string]string{
+		"/a/b/c/": "/a/b/",
+		"/a/b/":   "/a/",
+		"/a/":     "/",
+		"/":       "",
+		"":        "",
+	} {
+		if got := parentDir(dir); got != parent {
+			t.Errorf("parentDir(%q) = %q, want %q", dir, got, parent)
+		}
+	}
+}
+
+func TestDirRuleValues(t *testing.T) {
+	recursive := [2]uint8{0, READ | DIR | RECURSIVE}
+	direct := [2]uint8{0, READ | DIR}
+	exec := [2]uint8{EXEC | DIR, 0}
+
+	dirs := map[DirKey][2]uint8{
+		dirKey(t, "/a/", 0):     recursive,
+		dirKey(t, "/a/b/", 0):   direct,
+		dirKey(t, "/a/b/c/", 0): exec,
+		dirKey(t, "/a/b/", 7):   direct,
+		dirKey(t, "/x/", 7):     recursive,
+		dirKey(t, "/x/y/", 7):   exec,
+	}
+	sources := map[uint32]string{7: "/bin/sh"}
+
+	vals := dirRuleValues(dirs, sources)
+	if len(vals) != len(dirs) {
+		t.Fatalf("got %d values for %d directory rules", len(vals), len(dirs))
+	}
+
+	for _, tc := range []struct {
+		dir     string
+		source  uint32
+		inherit [2]uint8
+	}{
+		{"/a/", 0, [2]uint8{}},
+		{"/a/b/", 0, [2]uint8{0, recursive[FILE]}},
+		// "/a/b/" is not recursive, so the file rule comes from "/a/"
+		{"/a/b/c/", 0, [2]uint8{0, recursive[FILE]}},
+		// rules with and without fromSource never inherit from each other
+		{"/a/b/", 7, [2]uint8{}},
+		{"/x/y/", 7, [2]uint8{0, recursive[FILE]}},
+	} {
+		key := dirKey(t, tc.dir, tc.source)
+		val := vals[key]
+
+		if val.Self != dirs[key] {
+			t.Errorf("%s (source %d): self = %v, want %v", tc.dir, tc.source, val.Self, dirs[key])
+		}
+		if val.Inherit != tc.inherit {
+			t.Errorf("%s (source %d): inherit = %v, want %v", tc.dir, tc.source, val.Inherit, tc.inherit)
+		}
+		if int(val.Len) != len(tc.dir) {
+			t.Errorf("%s (source %d): len = %d, want %d", tc.dir, tc.source, val.Len, len(tc.dir))
+		}
+
+		source := strings.TrimRight(string(val.Source[:]), "\x00")
+		if source != sources[tc.source] {
+			t.Errorf("%s (source %d): source path = %q, want %q", tc.dir, tc.source, source, sources[tc.source])
+		}
+	}
+}
+
+func addrKey(t *testing.T, cidr string, bind bool) NetAddrKey {
+	t.Helper()
+	key, err := newNetAddrKey(cidr, bind)
+	if err != nil {
+		t.Fatalf("newNetAddrKey(%q): %s", cidr, err)
+	}
+	return key
+}
+
+func TestNewNetAddrKey(t *testing.T) {
+	for _, tc := range []struct {
+		cidr   string
+		bind   bool
+		family uint8
+		addr   string
+		ones   uint32
+	}{
+		{"10.0.0.0/8", false, afInet, "10.0.0.0", 8},
+		{"10.1.2.3", false, afInet, "10.1.2.3", 32},
+		{"192.168.1.77/24", true, afInet, "192.168.1.0", 24},
+		{"2001:db8::/32", false, afInet6, "2001:db8::", 32},
+		{"fe80::1", true, afInet6, "fe80::1", 128},
+		{"::/0", false, afInet6, "::", 0},
+		// the BPF programs match IPv4-mapped addresses with the IPv4 rules
+		{"::ffff:10.1.2.3", false, afInet, "10.1.2.3", 32},
+		{"::ffff:10.0.0.0/104", false, afInet, "10.0.0.0", 8},
+		{"::ffff:0:0/96", false, afInet, "0.0.0.0", 0},
+		// wider prefixes cover more than IPv4-mapped addresses
+		{"::ffff:0:0/95", false, afInet6, "::fffe:0:0", 95},
+	} {
+		key := addrKey(t, tc.cidr, tc.bind)
+
+		want := NetAddrKey{PrefixLen: 16 + tc.ones, Family: tc.family}
+		if tc.bind {
+			want.Op = NetAddrBind
+		}
+		if tc.family == afInet {
+			copy(want.Addr[:], net.ParseIP(tc.addr).To4())
+		} else {
+			copy(want.Addr[:], net.ParseIP(tc.addr).To16())
+		}
+
+		if key != want {
+			t.Errorf("newNetAddrKey(%q) = %+v, want %+v", tc.cidr, key, want)
+		}
+	}
+
+	for _, cidr := range []string{"", "10.0.0.0/33", "10.0.0", "example.com"} {
+		if _, err := newNetAddrKey(cidr, false); err == nil {
+			t.Errorf("newNetAddrKey accepted %q", cidr)
+		}
+	}
+}
+
+func TestPortRange(t *testing.T) {
+	for _, tc := range []struct {
+		ports  string
+		lo, hi uint16
+		ok     bool
+	}{
+		{"", 0, 65535, true},
+		{"443", 443, 443, true},
+		{"8000-8080", 8000, 8080, true},
+		{"0-65535", 0, 65535, true},
+		{"80-80", 80, 80, true},
+		{"8080-8000", 0, 0, false},
+		{"65536", 0, 0, false},
+		{"1-65536", 0, 0, false},
+		{"http", 0, 0, false},
+		{"-80", 0, 0, false},
+		{"80-", 0, 0, false},
+	} {
+		lo, hi, err := portRange(tc.ports)
+		if (err == nil) != tc.ok {
+			t.Errorf("portRange(%q) error = %v, want ok %t", tc.ports, err, tc.ok)
+			continue
+		}
+		if lo != tc.lo || hi != tc.hi {
+			t.Errorf("portRange(%q) = %d-%d, want %d-%d", tc.ports, lo, hi, tc.lo, tc.hi)
+		}
+	}
+}
+
+func TestContainsPrefix(t *testing.T) {
+	for _, tc := range []struct {
+		outer, inner string
+		bind         bool
+		want         bool
+	}{
+		{"10.0.0.0/8", "10.1.2.3", false, true},
+		{"10.0.0.0/8", "10.0.0.0/8", false, true},
+		{"10.0.0.0/8", "11.0.0.0/8", false, false},
+		{"10.1.2.3", "10.0.0.0/8", false, false},
+		{"10.0.0.0/12", "10.15.0.0/16", false, true},
+		{"10.0.0.0/12", "10.16.0.0/16", false, false},
+		{"0.0.0.0/0", "192.168.0.1", false, true},
+		{"2001:db8::/32", "2001:db8:1::/48", false, true},
+		{"2001:db8::/32", "2001:db9::/48", false, false},
+		// families and operations never cover each other
+		{"::/0", "10.0.0.0/8", false, false},
+		{"0.0.0.0/0", "10.0.0.0/8", true, false},
+	} {
+		outer := addrKey(t, tc.outer, false)
+		inner := addrKey(t, tc.inner, tc.bind)
+		if got := containsPrefix(outer, inner); got != tc.want {
+			t.Errorf("containsPrefix(%s, %s) = %t, want %t", tc.outer, tc.inner, got, tc.want)
+		}
+	}
+}
+
+func TestAddrRuleValues(t *testing.T) {
+	allow := [2]uint8{}
+	block := [2]uint8{DENY}
+
+	wide := addrKey(t, "10.0.0.0/8", false)
+	narrow := addrKey(t, "10.1.0.0/16", false)
+	host := addrKey(t, "10.1.2.3", false)
+	other := addrKey(t, "192.168.0.0/16", false)
+	bind := addrKey(t, "10.0.0.0/8", true)
+
+	addrs := map[NetAddrKey][]NetPortRange{
+		wide:   {{Lo: 0, Hi: 65535, Rule: block}},
+		narrow: {{Lo: 443, Hi: 443, Rule: allow}, {Lo: 22, Hi: 22, Rule: block}},
+		host:   {{Lo: 8080, Hi: 8080, Rule: allow}},
+		other:  {{Lo: 53, Hi: 53, Rule: allow}},
+		bind:   {{Lo: 80, Hi: 80, Rule: block}},
+	}
+
+	be := &BPFEnforcer{}
+	vals := be.addrRuleValues("test", addrs)
+	if len(vals) != len(addrs) {
+		t.Fatalf("got %d values for %d address prefixes", len(vals), len(addrs))
+	}
+
+	for key, want := range map[NetAddrKey][]NetPortRange{
+		wide: addrs[wide],
+		// blocked ranges of a prefix go first, the ranges of the enclosing prefixes follow
+		narrow: {{Lo: 22, Hi: 22, Rule: block}, {Lo: 443, Hi: 443, Rule: allow}, {Lo: 0, Hi: 65535, Rule: block}},
+		host:   {{Lo: 8080, Hi: 8080, Rule: allow}, {Lo: 22, Hi: 22, Rule: block}, {Lo: 443, Hi: 443, Rule: allow}, {Lo: 0, Hi: 65535, Rule: block}},
+		other:  addrs[other],
+		bind:   addrs[bind],
+	} {
+		val := vals[key]
+		if int(val.Count) != len(want) {
+			t.Errorf("%s: %d port ranges, want %d", net.IP(key.Addr[:]), val.Count, len(want))
+			continue
+		}
+		for i := range want {
+			if val.Ports[i] != want[i] {
+				t.Errorf("%s: port range %d = %+v, want %+v", net.IP(key.Addr[:]), i, val.Ports[i], want[i])
+			}
+		}
+	}
+}
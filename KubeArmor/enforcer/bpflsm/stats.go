@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Authors of KubeArmor
+
+package bpflsm
+
+import (
+	"errors"
+
+	"github.com/cilium/ebpf"
+
+	mon "github.com/kubearmor/KubeArmor/KubeArmor/monitor"
+)
+
+// StatsCounters contains the names of the counters of the enforcer in the order of enum stats_counter
+var StatsCounters = []string{
+	"verdict_cache_hit",
+	"path_cache_hit",
+	"path_cache_miss",
+	"alert_folded",
+	"alert_dropped",
+	"file_verdict_hit",
+}
+
+// HookStats returns the run time statistics of the enforcer programs keyed by event id, the statistics are only
+// recorded if the programs are built with BPF2GO_CFLAGS=-DKUBEARMOR_STATS
+func (be *BPFEnforcer) HookStats() (map[int32]mon.HookStats, error) {
+	stats := make(map[int32]mon.HookStats)
+
+	if err := mon.ReadHookStats(be.obj.KubearmorHookStats, stats); err != nil {
+		return nil, err
+	}
+	if err := mon.ReadHookStats(be.objPath.KubearmorHookStats, stats); err != nil {
+		return nil, err
+	}
+
+	return stats, nil
+}
+
+// Counters returns the cache and alert counters of the enforcer programs summed over all CPUs
+func (be *BPFEnforcer) Counters() (map[string]uint64, error) {
+	counters := make(map[string]uint64)
+
+	for _, m := range []*ebpf.Map{be.obj.KubearmorStatsCounters, be.objPath.KubearmorStatsCounters} {
+		if m == nil {
+			continue
+		}
+		for i, name := range StatsCounters {
+			var perCPU []uint64
+			if err := m.Lookup(uint32(i), &perCPU); err != nil {
+				return nil, err
+			}
+			for _, v := range perCPU {
+				counters[name] += v
+			}
+		}
+	}
+
+	return counters, nil
+}
+
+// ContainerMapUsage returns the number of containers in the outer rule map and the size of the outer maps
+func (be *BPFEnforcer) ContainerMapUsage() (int, int, error) {
+	var prev interface{}
+	used := 0
+
+	for {
+		var key NsKey
+		if err := be.BPFContainerMap.NextKey(prev, &key); err != nil {
+			if errors.Is(err, ebpf.ErrKeyNotExist) {
+				break
+			}
+			return 0, 0, err
+		}
+		used++
+		prev = key
+	}
+
+	return used, int(be.maxContainers), nil
+}
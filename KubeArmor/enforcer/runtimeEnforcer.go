@@ -10,8 +10,6 @@ import (
 	"path/filepath"
 	"strings"
 
-	cle "github.com/cilium/ebpf"
-
 	probe "github.com/kubearmor/KubeArmor/KubeArmor/utils/bpflsmprobe"
 
 	kl "github.com/kubearmor/KubeArmor/KubeArmor/common"
@@ -117,9 +115,7 @@ bpf:
 		re.Logger.Print("Initialized BPF-LSM Enforcer")
 		re.EnforcerType = "BPFLSM"
 		// Tell System Monitor that BPF LSM got your back, so it's okay to take rest and do less work
-		if err := monitor.BpfConfigMap.Update(uint32(2), uint32(1), cle.UpdateAny); err != nil {
-			re.Logger.Warnf("Error Updating System Monitor Config Map to notify it about usage of BPF LSM Enforcer : %s", err.Error())
-		}
+		monitor.UpdateBPFLSMEnforcer(true)
 		logger.UpdateEnforcer(re.EnforcerType)
 		return re
 	}
@@ -233,10 +229,20 @@ func (re *RuntimeEnforcer) UpdateSecurityPolicies(endPoint tp.EndPoint) {
 	if re.EnforcerType == "BPFLSM" {
 		re.bpfEnforcer.UpdateSecurityPolicies(endPoint)
 	} else if re.EnforcerType == "AppArmor" {
+		for _, secPolicy := range endPoint.SecurityPolicies {
+			re.warnAddressRules(secPolicy.Metadata["policyName"], secPolicy.Spec.Network)
+		}
 		re.appArmorEnforcer.UpdateSecurityPolicies(endPoint)
 	}
 }
 
+// warnAddressRules warns that the address rules of a policy are not enforced, only the BPF LSM enforcer supports them
+func (re *RuntimeEnforcer) warnAddressRules(policyName string, network tp.NetworkType) {
+	if len(network.MatchAddresses) > 0 {
+		re.Logger.Warnf("The %s enforcer does not support network address rules, ignoring the matchAddresses of policy %s", re.EnforcerType, policyName)
+	}
+}
+
 // UpdateHostSecurityPolicies Function
 func (re *RuntimeEnforcer) UpdateHostSecurityPolicies(secPolicies []tp.HostSecurityPolicy) {
 	// skip if runtime enforcer is not active
@@ -244,6 +250,12 @@ func (re *RuntimeEnforcer) UpdateHostSecurityPolicies(secPolicies []tp.HostSecur
 		return
 	}
 
+	if re.EnforcerType != "BPFLSM" {
+		for _, secPolicy := range secPolicies {
+			re.warnAddressRules(secPolicy.Metadata["policyName"], secPolicy.Spec.Network)
+		}
+	}
+
 	if re.EnforcerType == "BPFLSM" {
 		re.bpfEnforcer.UpdateHostSecurityPolicies(secPolicies)
 	} else if re.EnforcerType == "AppArmor" {
@@ -253,6 +265,36 @@ func (re *RuntimeEnforcer) UpdateHostSecurityPolicies(secPolicies []tp.HostSecur
 	}
 }
 
+// BPFStats returns the run time statistics and counters of the BPF LSM programs, nil if BPF LSM is not the enforcer
+func (re *RuntimeEnforcer) BPFStats() (map[int32]mon.HookStats, map[string]uint64, error) {
+	// skip if runtime enforcer is not active
+	if re == nil || re.EnforcerType != "BPFLSM" {
+		return nil, nil, nil
+	}
+
+	stats, err := re.bpfEnforcer.HookStats()
+	if err != nil {
+		return nil, nil, err
+	}
+
+	counters, err := re.bpfEnforcer.Counters()
+	if err != nil {
+		return nil, nil, err
+	}
+
+	return stats, counters, nil
+}
+
+// BPFContainerMapUsage returns the number of containers with rules and the number of containers the BPF LSM enforcer can hold
+func (re *RuntimeEnforcer) BPFContainerMapUsage() (int, int, error) {
+	// skip if runtime enforcer is not active
+	if re == nil || re.EnforcerType != "BPFLSM" {
+		return 0, 0, nil
+	}
+
+	return re.bpfEnforcer.ContainerMapUsage()
+}
+
 // DestroyRuntimeEnforcer Function
 func (re *RuntimeEnforcer) DestroyRuntimeEnforcer() error {
 	// skip if runtime enforcer is not active
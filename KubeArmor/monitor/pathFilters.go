@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Authors of KubeArmor
+
+package monitor
+
+import (
+	"strings"
+)
+
+// PathFilterLen is PATH_FILTER_LEN of the system monitor, longer prefixes can not be filtered in the kernel
+const PathFilterLen = 64
+
+// PathFilterKey Structure is the LPM key of kubearmor_path_filters, the namespaces are part of the matched prefix
+type PathFilterKey struct {
+	PrefixLen uint32
+	PidNS     uint32
+	MntNS     uint32
+	Path      [PathFilterLen]byte
+}
+
+// SplitPathFilters returns the path prefixes of a comma separated list
+func SplitPathFilters(filters string) []string {
+	prefixes := []string{}
+	for _, prefix := range strings.Split(filters, ",") {
+		if prefix = strings.TrimSpace(prefix); prefix != "" {
+			prefixes = append(prefixes, prefix)
+		}
+	}
+	return prefixes
+}
+
+// updatePathFilters replaces the path prefixes filtered for the namespaces, the prefixes of NsKey{} are filtered on
+// the whole node. BpfMapLock has to be held
+func (mon *SystemMonitor) updatePathFilters(nsKey NsKey, prefixes []string) {
+	if mon.BpfPathFilterMap == nil {
+		return
+	}
+
+	for _, prefix := range mon.PathFilters[nsKey] {
+		key := PathFilterKey{PrefixLen: 64 + 8*uint32(len(prefix)), PidNS: nsKey.PidNS, MntNS: nsKey.MntNS}
+		copy(key.Path[:], prefix)
+		if err := mon.BpfPathFilterMap.Delete(key); err != nil {
+			mon.Logger.Warnf("Cannot delete path filter %s nskey=%+v: %s", prefix, nsKey, err)
+		}
+	}
+	delete(mon.PathFilters, nsKey)
+
+	filtered := []string{}
+	for _, prefix := range prefixes {
+		if len(prefix) > PathFilterLen {
+			mon.Logger.Warnf("Path filter %s is longer than %d bytes, its opens are traced", prefix, PathFilterLen)
+			continue
+		}
+		key := PathFilterKey{PrefixLen: 64 + 8*uint32(len(prefix)), PidNS: nsKey.PidNS, MntNS: nsKey.MntNS}
+		copy(key.Path[:], prefix)
+		if err := mon.BpfPathFilterMap.Put(key, uint32(1)); err != nil {
+			mon.Logger.Warnf("Cannot insert path filter %s nskey=%+v: %s", prefix, nsKey, err)
+			continue
+		}
+		filtered = append(filtered, prefix)
+	}
+	if len(filtered) > 0 {
+		mon.PathFilters[nsKey] = filtered
+	}
+}
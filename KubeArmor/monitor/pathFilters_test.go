@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Authors of KubeArmor
+
+package monitor
+
+import (
+	"reflect"
+	"testing"
+)
+
+func TestSplitPathFilters(t *testing.T) {
+	for _, tc := range []struct {
+		filters string
+		want    []string
+	}{
+		{"", []string{}},
+		{" , ,", []string{}},
+		{"/proc/", []string{"/proc/"}},
+		{"/proc/,/sys/", []string{"/proc/", "/sys/"}},
+		{" /proc/ , /sys/fs/cgroup/ ,", []string{"/proc/", "/sys/fs/cgroup/"}},
+		{"/dev/,,/run/", []string{"/dev/", "/run/"}},
+		// prefixes without a trailing slash match every path starting with them
+		{"/usr/lib/locale", []string{"/usr/lib/locale"}},
+	} {
+		if got := SplitPathFilters(tc.filters); !reflect.DeepEqual(got, tc.want) {
+			t.Errorf("SplitPathFilters(%q) = %q, want %q", tc.filters, got, tc.want)
+		}
+	}
+}
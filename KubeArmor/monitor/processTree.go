@@ -11,6 +11,7 @@ import (
 	"syscall"
 	"time"
 
+	kl "github.com/kubearmor/KubeArmor/KubeArmor/common"
 	cfg "github.com/kubearmor/KubeArmor/KubeArmor/config"
 	tp "github.com/kubearmor/KubeArmor/KubeArmor/types"
 )
@@ -42,6 +43,10 @@ func (mon *SystemMonitor) AddContainerIDToNsMap(containerID string, namespace st
 	mon.NsMapLock.Unlock()
 
 	mon.BpfMapLock.Lock()
+	// the system monitor drops the events of untracked namespaces itself
+	if kl.ContainsElement(mon.UntrackedNamespaces, namespace) {
+		mon.UntrackedNsKeys[key] = true
+	}
 	if val, ok := mon.NamespacePidsMap[namespace]; ok {
 		// check if nskey already exist
 		found := false
@@ -55,11 +60,15 @@ func (mon *SystemMonitor) AddContainerIDToNsMap(containerID string, namespace st
 		if !found {
 			val.NsKeys = append(val.NsKeys, key)
 			mon.NamespacePidsMap[namespace] = val
+		}
+		// a known key still needs its state rewritten to carry the untracked flag
+		if !found || mon.UntrackedNsKeys[key] {
 			mon.UpdateNsKeyMap("ADDED", key, tp.Visibility{
 				File:         val.File,
 				Process:      val.Process,
 				Capabilities: val.Capability,
 				Network:      val.Network,
+				PathFilters:  val.PathFilters,
 			})
 		}
 	} else {
@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Authors of KubeArmor
+
+package monitor
+
+import (
+	cle "github.com/cilium/ebpf"
+)
+
+// StatsHistBuckets is the number of log2 buckets of the run time histograms
+const StatsHistBuckets = 32
+
+// HookStats contains the run time statistics of a BPF program summed over all CPUs
+type HookStats struct {
+	Count uint64
+	// enforcer: denied requests, monitor: events lost because the perf buffer was full
+	Errors  uint64
+	TotalNs uint64
+	// bucket i counts runs that took [2^i, 2^(i+1)) ns, the last bucket counts every run of at least 2^31 ns
+	Hist [StatsHistBuckets]uint64
+}
+
+// Add adds the statistics of s to hs
+func (hs *HookStats) Add(s HookStats) {
+	hs.Count += s.Count
+	hs.Errors += s.Errors
+	hs.TotalNs += s.TotalNs
+	for i := range hs.Hist {
+		hs.Hist[i] += s.Hist[i]
+	}
+}
+
+// ReadHookStats sums the per cpu statistics of a kubearmor_hook_stats map keyed by event id
+func ReadHookStats(m *cle.Map, stats map[int32]HookStats) error {
+	if m == nil {
+		return nil
+	}
+
+	var id uint32
+	var perCPU []HookStats
+
+	iter := m.Iterate()
+	for iter.Next(&id, &perCPU) {
+		total := stats[int32(id)]
+		for _, s := range perCPU {
+			total.Add(s)
+		}
+		stats[int32(id)] = total
+	}
+
+	return iter.Err()
+}
+
+// HookStats returns the run time statistics of the system monitor programs keyed by event id, the statistics are
+// only recorded if the programs are built with STATS=1
+func (mon *SystemMonitor) HookStats() (map[int32]HookStats, error) {
+	if mon == nil || mon.BpfModule == nil {
+		return nil, nil
+	}
+
+	stats := make(map[int32]HookStats)
+	if err := ReadHookStats(mon.BpfModule.Maps["kubearmor_hook_stats"], stats); err != nil {
+		return nil, err
+	}
+
+	return stats, nil
+}
@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Authors of KubeArmor
+
+package monitor
+
+import (
+	cle "github.com/cilium/ebpf"
+	"github.com/cilium/ebpf/link"
+)
+
+// visibility scopes of the syscalls, the keys of the visibility maps
+const (
+	fileProbe    uint32 = 0
+	processProbe uint32 = 1
+	networkProbe uint32 = 2
+	capsProbe    uint32 = 3
+)
+
+// fileArgT is FILE_TYPE_T of the BPF programs, the path is sent to userspace as strT
+const fileArgT uint8 = 17
+
+// SyscallInfo Structure is the entry of a syscall in the syscall table of the sys_enter/sys_exit dispatcher
+type SyscallInfo struct {
+	Types   uint64
+	EventID uint32
+	Scope   uint32
+	Traced  uint8
+	PathArg uint8 // 1-based index of the path argument checked against the path filters, 0 for none
+	Pad     [6]uint8
+}
+
+// argTypes encodes the types of the arguments like ARG_TYPE0..ARG_TYPE5
+func argTypes(types ...uint8) uint64 {
+	var enc uint64
+	for i, t := range types {
+		enc |= uint64(t) << (8 * i)
+	}
+	return enc
+}
+
+// dispatchedSyscalls contains the syscalls traced by the dispatcher, the syscalls traced by a probe pair with trace_ret_generic
+var dispatchedSyscalls = map[string]SyscallInfo{
+	"open":     {EventID: SysOpen, Types: argTypes(fileArgT, openFlagsT), Scope: fileProbe, PathArg: 1},
+	"openat":   {EventID: SysOpenAt, Types: argTypes(intT, fileArgT, openFlagsT), Scope: fileProbe, PathArg: 2},
+	"unlink":   {EventID: SysUnlink, Types: argTypes(intT, fileArgT), Scope: fileProbe},
+	"unlinkat": {EventID: SysUnlinkAt, Types: argTypes(intT, fileArgT, unlinkAtFlagT), Scope: fileProbe},
+	"rmdir":    {EventID: SysRmdir, Types: argTypes(0, fileArgT), Scope: fileProbe},
+	"chown":    {EventID: SysChown, Types: argTypes(fileArgT, intT, intT), Scope: fileProbe},
+	"fchownat": {EventID: SysFChownAt, Types: argTypes(intT, fileArgT, intT, intT, intT), Scope: fileProbe},
+	"setuid":   {EventID: SysSetuid, Types: argTypes(intT), Scope: capsProbe},
+	"setgid":   {EventID: SysSetgid, Types: argTypes(intT), Scope: capsProbe},
+	"ptrace":   {EventID: SysPtrace, Types: argTypes(ptraceReqT, intT, fileArgT), Scope: capsProbe},
+	"mount":    {EventID: SysMount, Types: argTypes(strT, strT, strT, mountFlagT, strT), Scope: capsProbe},
+	"umount":   {EventID: SysUmount, Types: argTypes(strT, umountFlagT), Scope: capsProbe},
+	"socket":   {EventID: SysSocket, Types: argTypes(sockDomT, sockTypeT, intT), Scope: networkProbe},
+	"connect":  {EventID: SysConnect, Types: argTypes(intT, sockAddrT), Scope: networkProbe},
+	"accept":   {EventID: SysAccept, Types: argTypes(intT, sockAddrT), Scope: networkProbe},
+	"bind":     {EventID: SysBind, Types: argTypes(intT, sockAddrT), Scope: networkProbe},
+	"listen":   {EventID: SysListen, Types: argTypes(intT, intT), Scope: networkProbe},
+}
+
+// attachSyscallDispatcher fills the syscall table and attaches the sys_enter/sys_exit dispatcher, it returns the syscalls
+// which do not need probes anymore. Nothing is dispatched if the dispatcher can not be attached
+func (mon *SystemMonitor) attachSyscallDispatcher() map[string]bool {
+	dispatched := make(map[string]bool)
+
+	table := mon.BpfModule.Maps["syscall_table"]
+	enter := mon.BpfModule.Programs["sys_enter_dispatch"]
+	exit := mon.BpfModule.Programs["sys_exit_dispatch"]
+	if table == nil || enter == nil || exit == nil {
+		mon.Logger.Warn("The syscall dispatcher is not available in the system monitor, using probes")
+		return dispatched
+	}
+
+	for name, info := range dispatchedSyscalls {
+		nr, ok := syscallNumbers[name]
+		if !ok {
+			continue
+		}
+		info.Traced = 1
+		if err := table.Update(nr, info, cle.UpdateAny); err != nil {
+			mon.Logger.Warnf("error adding %s to the syscall table: %v", name, err)
+			continue
+		}
+		dispatched[name] = true
+	}
+
+	var err error
+
+	mon.Probes["sys_enter_dispatch"], err = link.AttachRawTracepoint(link.RawTracepointOptions{Name: "sys_enter", Program: enter})
+	if err != nil {
+		delete(mon.Probes, "sys_enter_dispatch")
+		mon.Logger.Warnf("error attaching the sys_enter dispatcher, using probes: %v", err)
+		return map[string]bool{}
+	}
+
+	mon.Probes["sys_exit_dispatch"], err = link.AttachRawTracepoint(link.RawTracepointOptions{Name: "sys_exit", Program: exit})
+	if err != nil {
+		mon.Probes["sys_enter_dispatch"].Close()
+		delete(mon.Probes, "sys_enter_dispatch")
+		delete(mon.Probes, "sys_exit_dispatch")
+		mon.Logger.Warnf("error attaching the sys_exit dispatcher, using probes: %v", err)
+		return map[string]bool{}
+	}
+
+	return dispatched
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Authors of KubeArmor
+
+package monitor
+
+import "testing"
+
+// decArgType decodes an argument type like DEC_ARG_TYPE of the BPF programs
+func decArgType(n int, types uint64) uint8 {
+	return uint8(types >> (8 * n))
+}
+
+func TestArgTypes(t *testing.T) {
+	for _, tc := range []struct {
+		types []uint8
+		want  uint64
+	}{
+		{nil, 0},
+		{[]uint8{intT}, 0x01},
+		{[]uint8{0, fileArgT}, 0x1100},
+		{[]uint8{intT, fileArgT, openFlagsT}, 0x0d1101},
+		{[]uint8{strT, strT, strT, mountFlagT, strT}, 0x0a180a0a0a},
+		{[]uint8{intT, intT, intT, intT, intT, umountFlagT}, 0x190101010101},
+	} {
+		got := argTypes(tc.types...)
+		if got != tc.want {
+			t.Errorf("argTypes(%v) = %#x, want %#x", tc.types, got, tc.want)
+		}
+		for i := 0; i < 6; i++ {
+			var want uint8
+			if i < len(tc.types) {
+				want = tc.types[i]
+			}
+			if dec := decArgType(i, got); dec != want {
+				t.Errorf("argument %d of argTypes(%v) decodes to %d, want %d", i, tc.types, dec, want)
+			}
+		}
+	}
+}
+
+func TestSyscallTable(t *testing.T) {
+	// SYSCALL_TABLE_SIZE of the BPF programs
+	const tableSize = 512
+
+	seen := map[uint32]string{}
+	for name, nr := range syscallNumbers {
+		if nr >= tableSize {
+			t.Errorf("%s: syscall number %d is out of the syscall table", name, nr)
+		}
+		if other, ok := seen[nr]; ok {
+			t.Errorf("%s and %s have the same syscall number %d", name, other, nr)
+		}
+		seen[nr] = name
+
+		if _, ok := dispatchedSyscalls[name]; !ok {
+			t.Errorf("%s has a syscall number but no syscall table entry", name)
+		}
+	}
+
+	for name, info := range dispatchedSyscalls {
+		if info.EventID == 0 {
+			t.Errorf("%s: no event id", name)
+		}
+		if info.Scope > capsProbe {
+			t.Errorf("%s: unknown visibility scope %d", name, info.Scope)
+		}
+		// the dispatcher sets Traced for the syscalls of the arch
+		if info.Traced != 0 {
+			t.Errorf("%s: traced before being added to the syscall table", name)
+		}
+		if info.PathArg > 6 {
+			t.Errorf("%s: path argument %d out of the 6 syscall arguments", name, info.PathArg)
+		} else if info.PathArg > 0 && decArgType(int(info.PathArg)-1, info.Types) != fileArgT {
+			t.Errorf("%s: path argument %d is not a file path", name, info.PathArg)
+		}
+	}
+}
@@ -6,6 +6,16 @@
 
 package monitor
 
+// SyscallWrapperPrefix is the prefix of the syscall wrappers fexit programs attach to
+const SyscallWrapperPrefix = "__x64_sys_"
+
+// syscallNumbers maps the syscalls traced by the syscall dispatcher to their numbers
+var syscallNumbers = map[string]uint32{
+	"open": 2, "openat": 257, "unlink": 87, "unlinkat": 263, "rmdir": 84, "chown": 92, "fchownat": 260,
+	"setuid": 105, "setgid": 106, "ptrace": 101, "mount": 165, "umount": 166,
+	"socket": 41, "connect": 42, "accept": 43, "bind": 49, "listen": 50,
+}
+
 // Syscall numbers - x86
 const (
 	SysOpen     = 2
@@ -59,6 +69,7 @@ const (
 	SocketCreate  = 461
 	SocketConnect = 462
 	SocketAccept  = 463
+	SocketBind    = 465
 
 	Capable = 464
 )
@@ -415,4 +426,5 @@ var syscalls = map[int32]string{
 	462: "SOCKET_CONNECT",
 	463: "SOCKET_ACCEPT",
 	464: "CAPABLE",
+	465: "SOCKET_BIND",
 }
@@ -6,6 +6,17 @@
 
 package monitor
 
+// SyscallWrapperPrefix is the prefix of the syscall wrappers fexit programs attach to
+const SyscallWrapperPrefix = "__arm64_sys_"
+
+// syscallNumbers maps the syscalls traced by the syscall dispatcher to their numbers, open, unlink, rmdir and chown do
+// not exist on arm64 and umount is umount2
+var syscallNumbers = map[string]uint32{
+	"openat": 56, "unlinkat": 35, "fchownat": 54,
+	"setuid": 146, "setgid": 144, "ptrace": 117, "mount": 40, "umount": 39,
+	"socket": 198, "connect": 203, "accept": 202, "bind": 200, "listen": 201,
+}
+
 // Syscall arm/aarch
 const (
 	// not present in arm but kept to not break x86-64 dependent code
@@ -62,6 +73,7 @@ const (
 	SocketCreate  = 461
 	SocketConnect = 462
 	SocketAccept  = 463
+	SocketBind    = 465
 
 	Capable = 464
 )
@@ -377,4 +389,5 @@ var syscalls = map[int32]string{
 	462: "SOCKET_CONNECT",
 	463: "SOCKET_ACCEPT",
 	464: "CAPABLE",
+	465: "SOCKET_BIND",
 }
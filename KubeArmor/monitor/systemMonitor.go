@@ -18,9 +18,12 @@ import (
 
 	cle "github.com/cilium/ebpf"
 
+	"github.com/cilium/ebpf/btf"
 	"github.com/cilium/ebpf/link"
 	"github.com/cilium/ebpf/perf"
+	"github.com/cilium/ebpf/ringbuf"
 	"github.com/cilium/ebpf/rlimit"
+	"golang.org/x/sys/unix"
 
 	kl "github.com/kubearmor/KubeArmor/KubeArmor/common"
 	cfg "github.com/kubearmor/KubeArmor/KubeArmor/config"
@@ -33,11 +36,10 @@ const (
 	PermissionDenied = -13
 	MaxStringLen     = 4096
 	PinPath          = "/sys/fs/bpf"
-	visibilityOff    = uint32(1)
-	visibilityOn     = uint32(0)
 	// how many event the channel can hold
-	SyscallChannelSize   = 1 << 13 //8192
-	DefaultVisibilityKey = uint32(0xc0ffee)
+	SyscallChannelSize = 1 << 13 //8192
+	// NS_UNTRACKED of the system monitor, the events of the container are not sent
+	nsUntracked = uint32(1 << 0)
 )
 
 // ======================= //
@@ -50,6 +52,20 @@ type NsKey struct {
 	MntNS uint32
 }
 
+// NsState Structure is the state of a container in kubearmor_ns_state
+type NsState struct {
+	Visibility uint32 // 1 << scope for each traced probe scope
+	Flags      uint32
+}
+
+// MonitorConfig Structure is monitor_config of the system monitor, the only variable of its .data section
+type MonitorConfig struct {
+	BPFLSMEnforcer    uint32
+	DefaultVisibility uint32
+	MonitorHost       uint32
+	MonitorContainer  uint32
+}
+
 // NsVisibility Structure
 type NsVisibility struct {
 	NsKeys     []NsKey
@@ -57,6 +73,8 @@ type NsVisibility struct {
 	Process    bool
 	Capability bool
 	Network    bool
+
+	PathFilters []string
 }
 
 // ===================== //
@@ -128,12 +146,13 @@ type SystemMonitor struct {
 	NsMapLock *sync.RWMutex
 
 	// system monitor
-	BpfModule            *cle.Collection
-	BpfConfigMap         *cle.Map
-	BpfNsVisibilityMap   *cle.Map
-	BpfVisibilityMapSpec cle.MapSpec
+	BpfModule        *cle.Collection
+	BpfNsStateMap    *cle.Map
+	BpfPathFilterMap *cle.Map
+	Config           MonitorConfig
 
-	NsVisibilityMap  map[NsKey]*cle.Map
+	UntrackedNsKeys  map[NsKey]bool
+	PathFilters      map[NsKey][]string
 	NamespacePidsMap map[string]NsVisibility
 	BpfMapLock       *sync.RWMutex
 	PinPath          string
@@ -147,6 +166,8 @@ type SystemMonitor struct {
 	// system events
 	SyscallChannel chan []byte
 	SyscallPerfMap *perf.Reader
+	// used instead of SyscallPerfMap if sys_events is a ring buffer
+	SyscallRingBuf *ringbuf.Reader
 
 	// lists to skip
 	UntrackedNamespaces []string
@@ -191,14 +212,9 @@ func NewSystemMonitor(node *tp.Node, nodeLock **sync.RWMutex, logger *fd.Feeder,
 	mon.execLogMapLock = new(sync.RWMutex)
 
 	mon.BpfMapLock = new(sync.RWMutex)
-	mon.NsVisibilityMap = make(map[NsKey]*cle.Map)
+	mon.UntrackedNsKeys = make(map[NsKey]bool)
 	mon.NamespacePidsMap = make(map[string]NsVisibility)
-	mon.BpfVisibilityMapSpec = cle.MapSpec{
-		Type:       cle.Hash,
-		KeySize:    4,
-		ValueSize:  4,
-		MaxEntries: 4,
-	}
+	mon.PathFilters = make(map[NsKey][]string)
 
 	// assign the value of untracked ns from GlobalCfg
 	mon.UntrackedNamespaces = make([]string, len(cfg.GlobalCfg.ConfigUntrackedNs))
@@ -212,170 +228,165 @@ func NewSystemMonitor(node *tp.Node, nodeLock **sync.RWMutex, logger *fd.Feeder,
 
 // InitBPFMaps Function
 func (mon *SystemMonitor) initBPFMaps() error {
-	visibilityMap, errviz := cle.NewMapWithOptions(
+	nsStateMap, errstate := cle.NewMapWithOptions(
 		&cle.MapSpec{
-			Name:       "kubearmor_visibility",
-			Type:       cle.HashOfMaps,
+			Name:       "kubearmor_ns_state",
+			Type:       cle.Hash,
 			KeySize:    8,
-			ValueSize:  4,
+			ValueSize:  uint32(binary.Size(NsState{})),
 			MaxEntries: 65535,
 			Pinning:    cle.PinByName,
-			InnerMap:   &mon.BpfVisibilityMapSpec,
 		}, cle.MapOptions{
 			PinPath: mon.PinPath,
 		})
-	mon.BpfNsVisibilityMap = visibilityMap
-	mon.UpdateVisibility()
+	mon.BpfNsStateMap = nsStateMap
 
-	bpfConfigMap, errconfig := cle.NewMapWithOptions(
+	pathFilterMap, errfilter := cle.NewMapWithOptions(
 		&cle.MapSpec{
-			Name:       "kubearmor_config",
-			Type:       cle.Hash,
-			KeySize:    4,
+			Name:       "kubearmor_path_filters",
+			Type:       cle.LPMTrie,
+			KeySize:    uint32(binary.Size(PathFilterKey{})),
 			ValueSize:  4,
-			MaxEntries: 16,
+			MaxEntries: 1024,
+			Flags:      unix.BPF_F_NO_PREALLOC,
 			Pinning:    cle.PinByName,
-			InnerMap:   &mon.BpfVisibilityMapSpec,
 		}, cle.MapOptions{
 			PinPath: mon.PinPath,
 		})
-	mon.BpfConfigMap = bpfConfigMap
-	if cfg.GlobalCfg.HostPolicy {
-		if err := mon.BpfConfigMap.Update(uint32(0), uint32(1), cle.UpdateAny); err != nil {
-			mon.Logger.Errf("Error Updating System Monitor Config Map to enable host visbility : %s", err.Error())
-		}
+	mon.BpfPathFilterMap = pathFilterMap
+	mon.UpdateVisibility()
+
+	return errors.Join(errstate, errfilter)
+}
+
+// updateMonitorConfig writes the config into the loaded system monitor, kernels without global data keep it in
+// monitor_config_map. BpfMapLock has to be held
+func (mon *SystemMonitor) updateMonitorConfig() {
+	if mon.BpfModule == nil {
+		return
 	}
-	if cfg.GlobalCfg.Policy {
-		if err := mon.BpfConfigMap.Update(uint32(1), uint32(1), cle.UpdateAny); err != nil {
-			mon.Logger.Errf("Error Updating System Monitor Config Map to enable container visbility : %s", err.Error())
-		}
+
+	configMap := mon.BpfModule.Maps[".data"]
+	if configMap == nil {
+		configMap = mon.BpfModule.Maps["monitor_config_map"]
+	}
+	if configMap == nil {
+		mon.Logger.Warn("Cannot locate the config of the system monitor")
+		return
 	}
 
-	return errors.Join(errviz, errconfig)
+	if err := configMap.Update(uint32(0), mon.Config, cle.UpdateAny); err != nil {
+		mon.Logger.Errf("Error Updating System Monitor Config %+v: %s", mon.Config, err.Error())
+	}
+}
+
+// UpdateBPFLSMEnforcer Function tells the system monitor whether the BPF LSM enforcer alerts the failed syscalls
+func (mon *SystemMonitor) UpdateBPFLSMEnforcer(enabled bool) {
+	mon.BpfMapLock.Lock()
+	defer mon.BpfMapLock.Unlock()
+
+	mon.Config.BPFLSMEnforcer = 0
+	if enabled {
+		mon.Config.BPFLSMEnforcer = 1
+	}
+	mon.updateMonitorConfig()
 }
 
 // DestroyBPFMaps Function
 func (mon *SystemMonitor) DestroyBPFMaps() {
-	if mon.BpfNsVisibilityMap != nil {
-		err := mon.BpfNsVisibilityMap.Unpin()
+	if mon.BpfNsStateMap != nil {
+		err := mon.BpfNsStateMap.Unpin()
 		if err != nil {
-			mon.Logger.Warnf("error unpinning bpf map kubearmor_visibility %v", err)
+			mon.Logger.Warnf("error unpinning bpf map kubearmor_ns_state %v", err)
 		}
-		err = mon.BpfNsVisibilityMap.Close()
+		err = mon.BpfNsStateMap.Close()
 		if err != nil {
-			mon.Logger.Warnf("error closing bpf map kubearmor_visibility %v", err)
+			mon.Logger.Warnf("error closing bpf map kubearmor_ns_state %v", err)
 		}
 	}
 
-	if mon.BpfConfigMap != nil {
-		err := mon.BpfConfigMap.Unpin()
+	if mon.BpfPathFilterMap != nil {
+		err := mon.BpfPathFilterMap.Unpin()
 		if err != nil {
-			mon.Logger.Warnf("error unpinning bpf map kubearmor_config %v", err)
+			mon.Logger.Warnf("error unpinning bpf map kubearmor_path_filters %v", err)
 		}
-		err = mon.BpfConfigMap.Close()
+		err = mon.BpfPathFilterMap.Close()
 		if err != nil {
-			mon.Logger.Warnf("error closing bpf map kubearmor_config %v", err)
+			mon.Logger.Warnf("error closing bpf map kubearmor_path_filters %v", err)
 		}
 	}
 }
 
-// UpdateNsKeyMap Function
-func (mon *SystemMonitor) UpdateNsKeyMap(action string, nsKey NsKey, visibility tp.Visibility) {
-	var err error
-
-	file := cle.MapKV{
-		Key:   uint32(0),
-		Value: visibilityOff,
-	}
-	process := cle.MapKV{
-		Key:   uint32(1),
-		Value: visibilityOff,
-	}
-	network := cle.MapKV{
-		Key:   uint32(2),
-		Value: visibilityOff,
-	}
-	capability := cle.MapKV{
-		Key:   uint32(3),
-		Value: visibilityOff,
-	}
+// visibilityBits returns the probe scopes traced for the visibility
+func visibilityBits(visibility tp.Visibility) uint32 {
+	bits := uint32(0)
 	if visibility.File {
-		file.Value = visibilityOn
+		bits |= 1 << fileProbe
 	}
 	if visibility.Process {
-		process.Value = visibilityOn
+		bits |= 1 << processProbe
+	}
+	if visibility.Network {
+		bits |= 1 << networkProbe
 	}
 	if visibility.Capabilities {
-		capability.Value = visibilityOn
+		bits |= 1 << capsProbe
 	}
-	if visibility.Network {
-		network.Value = visibilityOn
+	return bits
+}
+
+// UpdateNsKeyMap Function
+func (mon *SystemMonitor) UpdateNsKeyMap(action string, nsKey NsKey, visibility tp.Visibility) {
+	state := NsState{
+		Visibility: visibilityBits(visibility),
+	}
+	if mon.UntrackedNsKeys[nsKey] {
+		state.Flags |= nsUntracked
 	}
 
 	if action == "ADDED" {
-		spec := mon.BpfVisibilityMapSpec
-		spec.Contents = append(spec.Contents, file)
-		spec.Contents = append(spec.Contents, process)
-		spec.Contents = append(spec.Contents, network)
-		spec.Contents = append(spec.Contents, capability)
-		visibilityMap, err := cle.NewMap(&spec)
+		err := mon.BpfNsStateMap.Put(nsKey, state)
 		if err != nil {
-			mon.Logger.Warnf("Cannot create bpf map %s", err)
+			mon.Logger.Warnf("Cannot insert visibility state into kernel nskey=%+v, error=%s", nsKey, err)
 			return
 		}
-		mon.NsVisibilityMap[nsKey] = visibilityMap
-		err = mon.BpfNsVisibilityMap.Put(nsKey, visibilityMap)
-		if err != nil {
-			mon.Logger.Warnf("Cannot insert insert visibility map into kernel nskey=%+v, error=%s", nsKey, err)
-		}
-		mon.Logger.Printf("Successfully added visibility map with key=%+v to the kernel", nsKey)
+		mon.updatePathFilters(nsKey, visibility.PathFilters)
+		mon.Logger.Printf("Successfully added visibility state with key=%+v to the kernel", nsKey)
 	} else if action == "MODIFIED" {
-		visibilityMap := mon.NsVisibilityMap[nsKey]
-		if visibilityMap == nil {
-			mon.Logger.Warnf("Cannot locate visibility map. nskey=%+v, action=modified", nsKey)
-			return
-		}
-
-		err = visibilityMap.Put(file.Key, file.Value)
-		if err != nil {
-			mon.Logger.Warnf("Cannot update visibility map. nskey=%+v, value=%+v, scope=file", nsKey, file.Value)
-		}
-		err = visibilityMap.Put(process.Key, process.Value)
-		if err != nil {
-			mon.Logger.Warnf("Cannot update visibility map. nskey=%+v, value=%+v, scope=process", nsKey, process.Value)
-		}
-		err = visibilityMap.Put(network.Key, network.Value)
+		err := mon.BpfNsStateMap.Update(nsKey, state, cle.UpdateExist)
 		if err != nil {
-			mon.Logger.Warnf("Cannot update visibility map. nskey=%+v, value=%+v, scope=network", nsKey, network.Value)
-		}
-		err = visibilityMap.Put(capability.Key, capability.Value)
-		if err != nil {
-			mon.Logger.Warnf("Cannot update visibility map. nskey=%+v, value=%+v, scope=capability", nsKey, capability.Value)
+			mon.Logger.Warnf("Cannot update visibility state. nskey=%+v, value=%+v, error=%s", nsKey, state, err)
+			return
 		}
+		mon.updatePathFilters(nsKey, visibility.PathFilters)
 
 		// Need to lock NsMap to print the following log message
 		mon.NsMapLock.RLock()
-		mon.Logger.Printf("Updated visibility map with key=%+v for cid %s", nsKey, mon.NsMap[nsKey])
+		mon.Logger.Printf("Updated visibility state with key=%+v for cid %s", nsKey, mon.NsMap[nsKey])
 		mon.NsMapLock.RUnlock()
 	} else if action == "DELETED" {
-		err := mon.BpfNsVisibilityMap.Delete(nsKey)
+		mon.updatePathFilters(nsKey, nil)
+		delete(mon.UntrackedNsKeys, nsKey)
+		err := mon.BpfNsStateMap.Delete(nsKey)
 		if err != nil {
-			mon.Logger.Warnf("Cannot locate visibility map. nskey=%+v, action=deleted", nsKey)
+			mon.Logger.Warnf("Cannot locate visibility state. nskey=%+v, action=deleted", nsKey)
 			return
 		}
-		delete(mon.NsVisibilityMap, nsKey)
-		mon.Logger.Printf("Successfully deleted visibility map with key=%+v from the kernel", nsKey)
+		mon.Logger.Printf("Successfully deleted visibility state with key=%+v from the kernel", nsKey)
 	}
 }
 
-// UpdateVisibility Function updates host visibility and global default visibility map based on the global config
+// UpdateVisibility Function updates host visibility and global default visibility based on the global config
 func (mon *SystemMonitor) UpdateVisibility() {
 	hostNSKey := NsKey{
 		PidNS: 0,
 		MntNS: 0,
 	}
 
-	hostVisibility := tp.Visibility{}
+	// the prefixes of the host key are filtered on the whole node
+	hostVisibility := tp.Visibility{
+		PathFilters: SplitPathFilters(cfg.GlobalCfg.PathFilters),
+	}
 	if cfg.GlobalCfg.HostPolicy {
 		visibilityParams := cfg.GlobalCfg.HostVisibility
 		if strings.Contains(visibilityParams, "file") {
@@ -392,11 +403,6 @@ func (mon *SystemMonitor) UpdateVisibility() {
 		}
 	}
 
-	nsKey := NsKey{
-		PidNS: DefaultVisibilityKey,
-		MntNS: DefaultVisibilityKey,
-	}
-
 	visibility := tp.Visibility{}
 	{
 		visibilityParams := cfg.GlobalCfg.Visibility
@@ -417,7 +423,8 @@ func (mon *SystemMonitor) UpdateVisibility() {
 	mon.BpfMapLock.Lock()
 	defer mon.BpfMapLock.Unlock()
 	mon.UpdateNsKeyMap("ADDED", hostNSKey, hostVisibility)
-	mon.UpdateNsKeyMap("ADDED", nsKey, visibility)
+	mon.Config.DefaultVisibility = visibilityBits(visibility)
+	mon.updateMonitorConfig()
 }
 
 // InitBPF Function
@@ -460,6 +467,7 @@ func (mon *SystemMonitor) InitBPF() error {
 	if err != nil {
 		return fmt.Errorf("cannot load bpf module specs %v", err)
 	}
+	fexitSyscalls := prepareFexitPrograms(bpfModuleSpec)
 	mon.BpfModule, err = cle.NewCollectionWithOptions(
 		bpfModuleSpec,
 		cle.CollectionOptions{
@@ -468,10 +476,35 @@ func (mon *SystemMonitor) InitBPF() error {
 			},
 		},
 	)
+	if err != nil && len(fexitSyscalls) > 0 {
+		mon.Logger.Warnf("error loading fexit programs, using kprobes: %v", err)
+		for name := range fexitSyscalls {
+			delete(bpfModuleSpec.Programs, "fexit__"+name)
+		}
+		fexitSyscalls = nil
+		mon.BpfModule, err = cle.NewCollectionWithOptions(
+			bpfModuleSpec,
+			cle.CollectionOptions{
+				Maps: cle.MapOptions{
+					PinPath: PinPath,
+				},
+			},
+		)
+	}
 	if err != nil {
 		return fmt.Errorf("bpf module is nil %v", err)
 	}
 
+	mon.BpfMapLock.Lock()
+	if cfg.GlobalCfg.HostPolicy {
+		mon.Config.MonitorHost = 1
+	}
+	if cfg.GlobalCfg.Policy {
+		mon.Config.MonitorContainer = 1
+	}
+	mon.updateMonitorConfig()
+	mon.BpfMapLock.Unlock()
+
 	mon.Logger.Print("Initialized the eBPF system monitor")
 
 	systemCalls := []string{"open", "openat", "execve", "execveat", "socket", "connect", "accept", "bind", "listen", "unlink", "unlinkat", "rmdir", "ptrace", "chown", "setuid", "setgid", "fchownat", "mount", "umount"}
@@ -480,12 +513,33 @@ func (mon *SystemMonitor) InitBPF() error {
 	sysKprobes := []string{"do_exit", "security_bprm_check", "security_file_open", "security_path_mknod", "security_path_unlink", "security_path_rmdir", "security_ptrace_access_check"}
 	netSyscalls := []string{"tcp_connect"}
 	netRetSyscalls := []string{"inet_csk_accept"}
+	// functions renaming directories, changing the root and moving mounts, which change the cwd of tasks without a chdir
+	cwdChanges := []string{"vfs_rename", "set_fs_root", "path_mount", "path_umount", SyscallWrapperPrefix + "move_mount"}
 
 	if mon.BpfModule != nil {
 
 		mon.Probes = make(map[string]link.Link)
 
+		dispatched := make(map[string]bool)
+		if cfg.GlobalCfg.BPFSyscallDispatch {
+			dispatched = mon.attachSyscallDispatcher()
+		}
+
 		for _, syscallName := range systemCalls {
+			if dispatched[syscallName] {
+				continue
+			}
+
+			if fexitSyscalls[syscallName] {
+				mon.Probes["fexit__"+syscallName], err = link.AttachTracing(link.TracingOptions{Program: mon.BpfModule.Programs["fexit__"+syscallName]})
+				if err == nil {
+					continue
+				}
+				delete(mon.Probes, "fexit__"+syscallName)
+				delete(fexitSyscalls, syscallName)
+				mon.Logger.Warnf("error attaching fexit %s, using kprobes: %v", syscallName, err)
+			}
+
 			mon.Probes["kprobe__"+syscallName], err = link.Kprobe("sys_"+syscallName, mon.BpfModule.Programs["kprobe__"+syscallName], nil)
 			if err != nil {
 				mon.Logger.Warnf("error loading kprobe %s: %v", syscallName, err)
@@ -499,6 +553,10 @@ func (mon *SystemMonitor) InitBPF() error {
 		}
 
 		for _, sysTracepoint := range sysTracepoints {
+			// the arguments of openat are only saved for the tracepoint by the kprobe
+			if sysTracepoint[1] == "sys_exit_openat" && (fexitSyscalls["openat"] || dispatched["openat"]) {
+				continue
+			}
 			mon.Probes[sysTracepoint[1]], err = link.Tracepoint(sysTracepoint[0], sysTracepoint[1], mon.BpfModule.Programs[sysTracepoint[1]], nil)
 			if err != nil {
 				mon.Logger.Warnf("error:%s: %v", sysTracepoint, err)
@@ -512,6 +570,24 @@ func (mon *SystemMonitor) InitBPF() error {
 			}
 		}
 
+		// the cwd is cached per task on kernels with task storage for tracing programs
+		if prog := mon.BpfModule.Programs["kprobe__set_fs_pwd"]; prog != nil {
+			mon.Probes["kprobe__set_fs_pwd"], err = link.Kprobe("set_fs_pwd", prog, nil)
+			if err != nil {
+				delete(mon.Probes, "kprobe__set_fs_pwd")
+				mon.Logger.Warnf("error loading kprobe set_fs_pwd: %v", err)
+			}
+
+			// without them the cached cwd of a task is only resolved again after a chdir
+			for _, fn := range cwdChanges {
+				mon.Probes["kretprobe__cwd_cache_bump_"+fn], err = link.Kretprobe(fn, mon.BpfModule.Programs["kretprobe__cwd_cache_bump"], nil)
+				if err != nil {
+					delete(mon.Probes, "kretprobe__cwd_cache_bump_"+fn)
+					mon.Logger.Warnf("error loading kretprobe %s, the cached cwd may be stale after it: %v", fn, err)
+				}
+			}
+		}
+
 		for _, netSyscall := range netSyscalls {
 			mon.Probes["kprobe__"+netSyscall], err = link.Kprobe(netSyscall, mon.BpfModule.Programs["kprobe__"+netSyscall], nil)
 			if err != nil {
@@ -528,15 +604,49 @@ func (mon *SystemMonitor) InitBPF() error {
 
 		mon.SyscallChannel = make(chan []byte, SyscallChannelSize)
 
-		mon.SyscallPerfMap, err = perf.NewReader(mon.BpfModule.Maps["sys_events"], os.Getpagesize()*1024)
-		if err != nil {
-			mon.Logger.Warnf("error initializing events perf map: %v", err)
+		// the object is built with a ring buffer on kernels supporting it
+		if events := mon.BpfModule.Maps["sys_events"]; events != nil && events.Type() == cle.RingBuf {
+			mon.SyscallRingBuf, err = ringbuf.NewReader(events)
+			if err != nil {
+				mon.Logger.Warnf("error initializing events ring buffer: %v", err)
+			}
+		} else {
+			mon.SyscallPerfMap, err = perf.NewReader(events, os.Getpagesize()*1024)
+			if err != nil {
+				mon.Logger.Warnf("error initializing events perf map: %v", err)
+			}
 		}
 	}
 
 	return nil
 }
 
+// prepareFexitPrograms sets the attach targets of the fexit programs and returns the syscalls they trace, programs
+// whose syscall wrapper is not in the kernel BTF are removed since they would fail the load of the whole collection
+func prepareFexitPrograms(spec *cle.CollectionSpec) map[string]bool {
+	fexit := make(map[string]bool)
+
+	kernelSpec, err := btf.LoadKernelSpec()
+
+	for progName, prog := range spec.Programs {
+		name, ok := strings.CutPrefix(progName, "fexit__")
+		if !ok {
+			continue
+		}
+
+		var fn *btf.Func
+		if err != nil || kernelSpec.TypeByName(SyscallWrapperPrefix+name, &fn) != nil {
+			delete(spec.Programs, progName)
+			continue
+		}
+
+		prog.AttachTo = SyscallWrapperPrefix + name
+		fexit[name] = true
+	}
+
+	return fexit
+}
+
 // DestroySystemMonitor Function
 func (mon *SystemMonitor) DestroySystemMonitor() error {
 
@@ -551,6 +661,12 @@ func (mon *SystemMonitor) DestroySystemMonitor() error {
 		}
 	}
 
+	if mon.SyscallRingBuf != nil {
+		if err := mon.SyscallRingBuf.Close(); err != nil {
+			return err
+		}
+	}
+
 	if mon.BpfModule != nil {
 		mon.BpfModule.Close()
 	}
@@ -575,7 +691,24 @@ func (mon *SystemMonitor) DestroySystemMonitor() error {
 
 // TraceSyscall Function
 func (mon *SystemMonitor) TraceSyscall() {
-	if mon.SyscallPerfMap != nil {
+	if mon.SyscallRingBuf != nil {
+		go func() {
+			for {
+				record, err := mon.SyscallRingBuf.Read()
+				if err != nil {
+					if errors.Is(err, ringbuf.ErrClosed) {
+						// This should only happen when we call DestroyMonitor while terminating the process.
+						mon.Logger.Warnf("Ring Buffer closed, exiting TraceSyscall %s", err.Error())
+						return
+					}
+					mon.Logger.Warnf("Ring Buffer Error : %s", err.Error())
+					continue
+				}
+
+				mon.SyscallChannel <- record.RawSample
+			}
+		}()
+	} else if mon.SyscallPerfMap != nil {
 		go func() {
 			for {
 				record, err := mon.SyscallPerfMap.Read()
@@ -598,7 +731,7 @@ func (mon *SystemMonitor) TraceSyscall() {
 			}
 		}()
 	} else {
-		mon.Logger.Err("Perf Buffer nil, exiting TraceSyscall")
+		mon.Logger.Err("Perf Buffer and Ring Buffer nil, exiting TraceSyscall")
 		return
 	}
 
@@ -290,3 +290,27 @@ func TestTraceSyscallWithHost(t *testing.T) {
 	}
 	t.Log("[PASS] Destroyed logger")
 }
+
+func TestVisibilityBits(t *testing.T) {
+	// NS_VISIBLE_ALL of the system monitor
+	const visibleAll = uint32(0xf)
+
+	for _, tc := range []struct {
+		visibility tp.Visibility
+		want       uint32
+	}{
+		{tp.Visibility{}, 0},
+		{tp.Visibility{File: true}, 1 << fileProbe},
+		{tp.Visibility{Process: true}, 1 << processProbe},
+		{tp.Visibility{Network: true}, 1 << networkProbe},
+		{tp.Visibility{Capabilities: true}, 1 << capsProbe},
+		{tp.Visibility{File: true, Network: true}, 0x5},
+		{tp.Visibility{File: true, Process: true, Network: true, Capabilities: true}, visibleAll},
+		// path filters are kept in their own map
+		{tp.Visibility{Process: true, PathFilters: []string{"/proc/"}}, 1 << processProbe},
+	} {
+		if got := visibilityBits(tc.visibility); got != tc.want {
+			t.Errorf("visibilityBits(%+v) = %#x, want %#x", tc.visibility, got, tc.want)
+		}
+	}
+}
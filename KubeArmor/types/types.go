@@ -123,6 +123,9 @@ type Node struct {
 
 	ContainerRuntimeVersion string `json:"containerRuntimeVersion"`
 
+	// number of pods the node can run, 0 if unknown
+	PodCapacity int `json:"podCapacity"`
+
 	// == //
 
 	LastUpdatedAt string `json:"last_updated_at"`
@@ -443,9 +446,22 @@ type NetworkProtocolType struct {
 	Action   string   `json:"action,omitempty"`
 }
 
+// NetworkAddressType Structure
+type NetworkAddressType struct {
+	CIDR  string `json:"cidr"`
+	Ports string `json:"ports,omitempty"`
+	Bind  bool   `json:"bind,omitempty"`
+
+	Severity int      `json:"severity,omitempty"`
+	Tags     []string `json:"tags,omitempty"`
+	Message  string   `json:"message,omitempty"`
+	Action   string   `json:"action,omitempty"`
+}
+
 // NetworkType Structure
 type NetworkType struct {
 	MatchProtocols []NetworkProtocolType `json:"matchProtocols,omitempty"`
+	MatchAddresses []NetworkAddressType  `json:"matchAddresses,omitempty"`
 
 	Severity int      `json:"severity,omitempty"`
 	Tags     []string `json:"tags,omitempty"`
@@ -584,6 +600,8 @@ type Visibility struct {
 	Process      bool `json:"process,omitempty"`
 	Network      bool `json:"network,omitempty"`
 	Capabilities bool `json:"capabilties,omitempty"`
+
+	PathFilters []string `json:"pathFilters,omitempty"`
 }
 
 // ================== //
@@ -9,6 +9,7 @@ import (
 	"encoding/binary"
 	"time"
 
+	"github.com/cilium/ebpf"
 	"github.com/cilium/ebpf/link"
 	"github.com/cilium/ebpf/ringbuf"
 	"github.com/cilium/ebpf/rlimit"
@@ -28,13 +29,22 @@ func CheckBPFLSMSupport() error {
 		return err
 	}
 
-	objs := probeObjects{}
-	if err := loadProbeObjects(&objs, nil); err != nil {
+	spec, err := loadProbe()
+	if err != nil {
+		return err
+	}
+
+	// the bpf_d_path programs are probed separately, they are rejected by kernels which support BPF LSM without it
+	objs := struct {
+		probeMaps
+		TestMemfd *ebpf.Program `ebpf:"test_memfd"`
+	}{}
+	if err := spec.LoadAndAssign(&objs, nil); err != nil {
 		return err
 	}
 	defer objs.KubearmorEvents.Close()
 	defer objs.KubearmorEvents.Unpin()
-	defer objs.Close()
+	defer objs.TestMemfd.Close()
 
 	kp, err := link.AttachLSM(link.LSMOptions{Program: objs.TestMemfd})
 	if err != nil {
@@ -65,3 +75,26 @@ func CheckBPFLSMSupport() error {
 
 	return binary.Read(bytes.NewBuffer(record.RawSample), binary.LittleEndian, &event)
 }
+
+// CheckBPFDPathSupport checks if bpf_d_path is allowed in the file_open and file_permission LSM hooks by loading programs using it
+// It returns an error if the verifier rejects them
+func CheckBPFDPathSupport() error {
+	if err := rlimit.RemoveMemlock(); err != nil {
+		return err
+	}
+
+	spec, err := loadProbe()
+	if err != nil {
+		return err
+	}
+
+	for _, name := range []string{"test_dpath_open", "test_dpath_perm"} {
+		prog, err := ebpf.NewProgram(spec.Programs[name])
+		if err != nil {
+			return err
+		}
+		prog.Close()
+	}
+
+	return nil
+}
@@ -53,7 +53,9 @@ type probeSpecs struct {
 //
 // It can be passed ebpf.CollectionSpec.Assign.
 type probeProgramSpecs struct {
-	TestMemfd *ebpf.ProgramSpec `ebpf:"test_memfd"`
+	TestDpathOpen *ebpf.ProgramSpec `ebpf:"test_dpath_open"`
+	TestDpathPerm *ebpf.ProgramSpec `ebpf:"test_dpath_perm"`
+	TestMemfd     *ebpf.ProgramSpec `ebpf:"test_memfd"`
 }
 
 // probeMapSpecs contains maps before they are loaded into the kernel.
@@ -95,11 +97,15 @@ func (m *probeMaps) Close() error {
 //
 // It can be passed to loadProbeObjects or ebpf.CollectionSpec.LoadAndAssign.
 type probePrograms struct {
-	TestMemfd *ebpf.Program `ebpf:"test_memfd"`
+	TestDpathOpen *ebpf.Program `ebpf:"test_dpath_open"`
+	TestDpathPerm *ebpf.Program `ebpf:"test_dpath_perm"`
+	TestMemfd     *ebpf.Program `ebpf:"test_memfd"`
 }
 
 func (p *probePrograms) Close() error {
 	return _ProbeClose(
+		p.TestDpathOpen,
+		p.TestDpathPerm,
 		p.TestMemfd,
 	)
 }
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Authors of KubeArmor
+
+package probe
+
+import "testing"
+
+func TestEmbeddedObjects(t *testing.T) {
+	// the objects are rebuilt from BPF/probe.bpf.c with go generate, bindings listing maps or programs they lack fail to load
+	spec, err := loadProbe()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := spec.Assign(&probeSpecs{}); err != nil {
+		t.Errorf("probe object does not match its bindings, run go generate: %s", err)
+	}
+}
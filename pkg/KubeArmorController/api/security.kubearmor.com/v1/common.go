@@ -212,8 +212,31 @@ type MatchHostNetworkProtocolType struct {
 	Action ActionType `json:"action,omitempty"`
 }
 
+// +kubebuilder:validation:Pattern=^[0-9]+(-[0-9]+)?$
+type MatchNetworkPortsType string
+
+type MatchNetworkAddressType struct {
+	CIDR string `json:"cidr"`
+
+	// +kubebuilder:validation:optional
+	Ports MatchNetworkPortsType `json:"ports,omitempty"`
+	// +kubebuilder:validation:optional
+	Bind bool `json:"bind,omitempty"`
+
+	// +kubebuilder:validation:optional
+	Severity SeverityType `json:"severity,omitempty"`
+	// +kubebuilder:validation:optional
+	Tags []string `json:"tags,omitempty"`
+	// +kubebuilder:validation:optional
+	Message string `json:"message,omitempty"`
+	// +kubebuilder:validation:optional
+	Action ActionType `json:"action,omitempty"`
+}
+
 type NetworkType struct {
 	MatchProtocols []MatchNetworkProtocolType `json:"matchProtocols,omitempty"`
+	// +kubebuilder:validation:optional
+	MatchAddresses []MatchNetworkAddressType `json:"matchAddresses,omitempty"`
 
 	// +kubebuilder:validation:optional
 	Severity SeverityType `json:"severity,omitempty"`
@@ -227,6 +250,8 @@ type NetworkType struct {
 
 type HostNetworkType struct {
 	MatchProtocols []MatchHostNetworkProtocolType `json:"matchProtocols,omitempty"`
+	// +kubebuilder:validation:optional
+	MatchAddresses []MatchNetworkAddressType `json:"matchAddresses,omitempty"`
 
 	// +kubebuilder:validation:optional
 	Severity SeverityType `json:"severity,omitempty"`
@@ -187,6 +187,13 @@ func (in *HostNetworkType) DeepCopyInto(out *HostNetworkType) {
 			(*in)[i].DeepCopyInto(&(*out)[i])
 		}
 	}
+	if in.MatchAddresses != nil {
+		in, out := &in.MatchAddresses, &out.MatchAddresses
+		*out = make([]MatchNetworkAddressType, len(*in))
+		for i := range *in {
+			(*in)[i].DeepCopyInto(&(*out)[i])
+		}
+	}
 	if in.Tags != nil {
 		in, out := &in.Tags, &out.Tags
 		*out = make([]string, len(*in))
@@ -479,6 +486,26 @@ func (in *MatchHostNetworkProtocolType) DeepCopy() *MatchHostNetworkProtocolType
 	return out
 }
 
+// DeepCopyInto is an autogenerated deepcopy function, copying the receiver, writing into out. in must be non-nil.
+func (in *MatchNetworkAddressType) DeepCopyInto(out *MatchNetworkAddressType) {
+	*out = *in
+	if in.Tags != nil {
+		in, out := &in.Tags, &out.Tags
+		*out = make([]string, len(*in))
+		copy(*out, *in)
+	}
+}
+
+// DeepCopy is an autogenerated deepcopy function, copying the receiver, creating a new MatchNetworkAddressType.
+func (in *MatchNetworkAddressType) DeepCopy() *MatchNetworkAddressType {
+	if in == nil {
+		return nil
+	}
+	out := new(MatchNetworkAddressType)
+	in.DeepCopyInto(out)
+	return out
+}
+
 // DeepCopyInto is an autogenerated deepcopy function, copying the receiver, writing into out. in must be non-nil.
 func (in *MatchNetworkProtocolType) DeepCopyInto(out *MatchNetworkProtocolType) {
 	*out = *in
@@ -549,6 +576,13 @@ func (in *NetworkType) DeepCopyInto(out *NetworkType) {
 			(*in)[i].DeepCopyInto(&(*out)[i])
 		}
 	}
+	if in.MatchAddresses != nil {
+		in, out := &in.MatchAddresses, &out.MatchAddresses
+		*out = make([]MatchNetworkAddressType, len(*in))
+		for i := range *in {
+			(*in)[i].DeepCopyInto(&(*out)[i])
+		}
+	}
 	if in.Tags != nil {
 		in, out := &in.Tags, &out.Tags
 		*out = make([]string, len(*in))